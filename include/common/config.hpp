@@ -9,8 +9,18 @@ struct ServerConfig {
     int port = 6379;
     std::string aof_file = "aof.log";
     size_t shard_count = 64;
-    bool aof_fsync_every_write = false;
+    std::string appendfsync = "everysec";  // or always, no
+    size_t auto_aof_rewrite_percentage = 100;  // growth since the last rewrite; 0 = never
+    size_t auto_aof_rewrite_min_size = 64 * 1024 * 1024;  // bytes
     size_t worker_threads = 4;  // thread pool for command execution
+    size_t net_threads = 1;     // event-loop threads (accept, I/O, parsing)
+    bool thread_per_core = false;  // shared-nothing: each net thread owns shards, no pool
+    std::string io_backend;     // "epoll", "kqueue", "io_uring"; empty = platform default
+    size_t maxmemory = 0;       // bytes; 0 = no limit
+    std::string maxmemory_policy = "noeviction";  // or allkeys-lru, allkeys-lfu, volatile-ttl
+    size_t maxmemory_samples = 5;  // keys compared per eviction
+    bool activedefrag = false;     // compact sparse slabs in the background
+    size_t active_defrag_threshold = 10;  // % of free slab space that starts a pass
 };
 
 // Load from file (key=value or key value per line). Missing keys keep defaults.
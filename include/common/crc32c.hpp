@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace mini_redis {
+
+// CRC-32C (Castagnoli, as in iSCSI and ext4): the SSE4.2 instruction where
+// the CPU has it, slicing-by-8 tables elsewhere. Pass a previous result as
+// `crc` to continue it over more bytes.
+uint32_t crc32c(const void* data, size_t len, uint32_t crc = 0);
+
+} // namespace mini_redis
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <bitset>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mini_redis {
+
+// A Redis-style glob compiled once and matched against many keys (KEYS,
+// SCAN MATCH). Supports * ? [abc] [^a-z] and \ escapes; an unterminated [
+// is a literal. The literal text before the first wildcard is checked up
+// front with one compare, and patterns that are only a literal, or a
+// literal followed by *, never reach the matcher.
+class Glob {
+public:
+    explicit Glob(std::string_view pattern);
+
+    bool matches(std::string_view key) const;
+
+private:
+    enum class Op : uint8_t { LITERAL, ANY, STAR, CLASS };
+
+    struct Token {
+        Op op;
+        char ch;           // LITERAL
+        uint32_t klass;    // CLASS: index into classes_
+    };
+
+    enum class Shape : uint8_t { EXACT, PREFIX, GENERAL };
+
+    bool match_tokens(std::string_view key) const;
+
+    std::string prefix_;
+    std::vector<Token> tokens_;  // what follows the prefix (GENERAL only)
+    std::vector<std::bitset<256>> classes_;
+    Shape shape_;
+};
+
+} // namespace mini_redis
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace mini_redis {
+
+// Memory outside the keyspace (which each shard's map counts itself).
+enum class MemoryKind : uint8_t {
+    CLIENT_BUFFERS,  // connections' read and write buffers
+    AOF_BUFFER,      // the AOF writer's file buffer
+    COUNT,
+};
+
+namespace memory_detail {
+
+// One thread's running totals. Only the owning thread writes them, so an
+// update is a relaxed load and store with no shared cache line; readers sum
+// every thread's slots. Slots of exited threads are folded into a total.
+struct ThreadCounters {
+    std::atomic<int64_t> bytes[static_cast<size_t>(MemoryKind::COUNT)] = {};
+
+    ThreadCounters();
+    ~ThreadCounters();
+};
+
+ThreadCounters& local();
+
+} // namespace memory_detail
+
+// Record `delta` bytes allocated (or, negative, freed) by this thread.
+inline void memory_add(MemoryKind kind, int64_t delta) {
+    auto& counter = memory_detail::local().bytes[static_cast<size_t>(kind)];
+    counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+// Bytes held across all threads.
+size_t memory_used(MemoryKind kind);
+
+// The process's resident set size, or 0 where it cannot be read.
+size_t resident_bytes();
+
+} // namespace mini_redis
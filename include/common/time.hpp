@@ -0,0 +1,27 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace mini_redis {
+
+namespace time_detail {
+inline std::atomic<uint64_t> cached_ms{0};  // 0 until the ticker starts
+} // namespace time_detail
+
+// Milliseconds since the Unix epoch, read from the monotonic clock: it is
+// anchored to the wall clock once, at first use, and never steps backwards.
+uint64_t precise_now_ms();
+
+// The same clock as of the ticker's last refresh (at most ~1 ms stale): one
+// relaxed load, for the command path. Reads precise_now_ms() until
+// start_clock_ticker() has run.
+inline uint64_t now_ms() {
+    uint64_t t = time_detail::cached_ms.load(std::memory_order_relaxed);
+    return t != 0 ? t : precise_now_ms();
+}
+
+// Start the thread that refreshes now_ms(). Idempotent.
+void start_clock_ticker();
+
+} // namespace mini_redis
@@ -0,0 +1,39 @@
+#pragma once
+
+namespace mini_redis::concurrency {
+
+// Epoch-based reclamation. Readers pin the current epoch for the duration of
+// a lookup; memory unlinked by a writer is retired rather than freed, and is
+// only freed once every thread pinned at the time has moved on (the global
+// epoch has advanced twice since). Pinning is a store to a per-thread record
+// plus a fence: no shared cache line is written on the read path.
+//
+// Guards nest; only the outermost one pins.
+class EpochGuard {
+public:
+    // pin = false makes a no-op guard (single-threaded structures).
+    explicit EpochGuard(bool pin = true);
+    ~EpochGuard();
+
+    EpochGuard(const EpochGuard&) = delete;
+    EpochGuard& operator=(const EpochGuard&) = delete;
+
+private:
+    bool pinned_;
+};
+
+// Free p with deleter(p) once no reader can still hold it. Any thread.
+void retire(void* p, void (*deleter)(void*));
+
+// Free what this thread has retired that no reader can still hold,
+// advancing the epoch as far as pinned readers allow. For a thread about to
+// go idle: retire() only reclaims every so many calls, so without this an
+// idle thread's last few retirements wait for its next burst of work.
+void flush_retired();
+
+template <typename T>
+void retire(T* p) {
+    retire(static_cast<void*>(p), [](void* q) { delete static_cast<T*>(q); });
+}
+
+} // namespace mini_redis::concurrency
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+namespace mini_redis::concurrency {
+
+// Unbounded lock-free multi-producer / single-consumer queue. Producers push
+// onto an intrusive stack with one CAS; the consumer detaches the whole
+// stack with one exchange and replays it oldest-first. There is no ABA
+// hazard because nodes are only ever removed all at once, by the consumer.
+template <typename T>
+class MpscQueue {
+public:
+    MpscQueue() = default;
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    ~MpscQueue() {
+        drain([](T&&) {});
+    }
+
+    // Any thread.
+    void push(T value) {
+        Node* node = new Node{std::move(value), head_.load(std::memory_order_relaxed)};
+        while (!head_.compare_exchange_weak(node->next, node,
+                                            std::memory_order_seq_cst,
+                                            std::memory_order_relaxed)) {
+        }
+    }
+
+    // Consumer thread only. Calls fn(T&&) for every queued item in push
+    // order and returns how many there were.
+    template <typename F>
+    size_t drain(F&& fn) {
+        Node* stack = head_.exchange(nullptr, std::memory_order_seq_cst);
+        Node* fifo = nullptr;
+        while (stack) {
+            Node* next = stack->next;
+            stack->next = fifo;
+            fifo = stack;
+            stack = next;
+        }
+        size_t n = 0;
+        while (fifo) {
+            Node* next = fifo->next;
+            fn(std::move(fifo->value));
+            delete fifo;
+            fifo = next;
+            ++n;
+        }
+        return n;
+    }
+
+private:
+    struct Node {
+        T value;
+        Node* next;
+    };
+
+    std::atomic<Node*> head_{nullptr};
+};
+
+} // namespace mini_redis::concurrency
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+
+namespace mini_redis::concurrency {
+
+// Bounded single-producer / single-consumer ring. One thread may push and
+// one (other) thread may pop; neither side takes a lock. Each side caches
+// the other's index so the shared cache line is only read when the cached
+// value says the ring looks full (producer) or empty (consumer).
+template <typename T>
+class SpscQueue {
+public:
+    // capacity is rounded up to a power of two.
+    explicit SpscQueue(size_t capacity) {
+        size_t cap = 2;
+        while (cap < capacity) cap <<= 1;
+        mask_ = cap - 1;
+        slots_ = std::make_unique<T[]>(cap);
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // Producer side. Returns false if the ring is full.
+    bool push(T value) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_cache_ > mask_) {
+            head_cache_ = head_.load(std::memory_order_acquire);
+            if (tail - head_cache_ > mask_)
+                return false;
+        }
+        slots_[tail & mask_] = std::move(value);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Returns false if the ring is empty.
+    bool pop(T& out) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_cache_) {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            if (head == tail_cache_)
+                return false;
+        }
+        out = std::move(slots_[head & mask_]);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    static constexpr size_t CACHE_LINE = 64;
+
+    std::unique_ptr<T[]> slots_;
+    size_t mask_ = 0;
+
+    alignas(CACHE_LINE) std::atomic<size_t> head_{0};  // written by consumer
+    size_t tail_cache_ = 0;                             // consumer's view of tail_
+
+    alignas(CACHE_LINE) std::atomic<size_t> tail_{0};  // written by producer
+    size_t head_cache_ = 0;                             // producer's view of head_
+};
+
+} // namespace mini_redis::concurrency
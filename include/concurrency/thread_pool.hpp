@@ -18,6 +18,14 @@ public:
     void enqueue(std::function<void()> task);
     void shutdown();
 
+    size_t size() const { return workers_.size(); }
+
+    // Run fn(i) for every i in [0, n) on the calling thread and any idle
+    // workers; returns when all have finished. The caller claims indices
+    // too, so this is safe from inside a pool task: it never waits on a
+    // task that is still queued.
+    void parallel_for(size_t n, const std::function<void(size_t)>& fn);
+
 private:
     void worker();
 
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <sys/uio.h>
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "storage/blob.hpp"
+
+namespace net {
+
+// Bytes a string holds on the heap (none while its contents fit inline).
+inline size_t heap_capacity(const std::string& s) {
+    static const size_t inline_capacity = std::string().capacity();
+    return s.capacity() > inline_capacity ? s.capacity() : 0;
+}
+
+// Per-reactor free list of byte buffers. Buffers keep their capacity while
+// pooled, so steady-state reads, request batches and replies reuse memory
+// instead of allocating. Only the owning reactor thread touches it.
+class BufferPool {
+public:
+    static constexpr size_t CHUNK_SIZE = 16 * 1024;
+
+    // Empty buffer with at least CHUNK_SIZE capacity.
+    std::string acquire();
+
+    // Return a buffer; oversized ones are freed rather than pooled.
+    void release(std::string&& buf);
+
+private:
+    std::vector<std::string> free_;
+};
+
+// Outgoing bytes as a chain of buffers. Small replies are serialized into
+// the last chunk; large ones (a worker's batch reply) are linked in whole,
+// and a large stored value is linked by reference, straight from the
+// keyspace. Sent bytes are dropped by advancing an offset, never by moving
+// the rest of the data, and spent chunks go back to the pool.
+class OutputBuffer {
+public:
+    explicit OutputBuffer(BufferPool* pool = nullptr) : pool_(pool) {}
+
+    bool empty() const { return segments_.empty(); }
+
+    // Buffer to append the next reply to.
+    std::string& tail();
+
+    // Queue `data` after everything already buffered.
+    void append(std::string&& data);
+
+    // Queue another buffer's contents (e.g. a worker's replies).
+    void append(OutputBuffer&& other);
+
+    // Queue shared value bytes without copying them.
+    void link(mini_redis::BlobRef blob);
+
+    // Make `chunk` the new tail. For buffers filled off the reactor thread,
+    // which must not touch its pool.
+    void open(std::string&& chunk);
+
+    // Fill up to max iovecs with unsent bytes, in order. Returns the count.
+    size_t gather(iovec* iov, size_t max) const;
+
+    // Drop the first n unsent bytes.
+    void consume(size_t n);
+
+    // Exchange contents; each side keeps its own pool.
+    void swap(OutputBuffer& other);
+
+    // Capacity of the owned chunks (linked values belong to the keyspace).
+    size_t memory_bytes() const;
+
+private:
+    // Owned bytes, or (when blob is set) a reference to shared ones.
+    struct Segment {
+        std::string bytes;
+        mini_redis::BlobRef blob;
+
+        std::string_view data() const { return blob ? blob.view() : std::string_view(bytes); }
+    };
+
+    void release(Segment& seg);
+
+    BufferPool* pool_;
+    std::deque<Segment> segments_;
+    size_t offset_ = 0;  // bytes of segments_.front() already sent
+};
+
+} // namespace net
@@ -3,8 +3,8 @@
 #include <string>
 #include <vector>
 #include <functional>
-#include <mutex>
 
+#include "net/buffer.hpp"
 #include "protocol/parser.hpp"
 #include "protocol/response.hpp"
 #include "storage/storage_engine.hpp"
@@ -13,9 +13,12 @@ namespace net {
 
 class Connection {
 public:
-    using SubmitFn = std::function<void(int fd, std::vector<std::string> cmd)>;
+    // Every complete command parsed from one read, in arrival order.
+    using Batch = protocol::CommandBatch;
+    using SubmitFn = std::function<void(int fd, Batch batch)>;
 
-    Connection(int fd, SubmitFn submit_fn);
+    // Buffers are drawn from (and returned to) the owning reactor's pool.
+    Connection(int fd, SubmitFn submit_fn, BufferPool& pool);
 
     ~Connection();
 
@@ -25,20 +28,40 @@ public:
     bool handle_write();
     bool wants_write() const;
 
-    // Called from main thread when worker pushes a response
-    void add_pending_response(std::string response);
+    // Completion-based I/O (io_uring): feed received bytes, and take the
+    // pending output to send. take_output swaps `out` (expected empty) with
+    // the write buffer. on_data returns false if the client sent something
+    // that is not RESP.
+    bool on_data(const char* data, size_t n);
+    bool take_output(OutputBuffer& out);
+
+    // Called on the owning reactor thread when a response is ready
+    void add_pending_response(OutputBuffer&& response);
+
+    // Owning reactor thread: replies serialized in place (see ResponseWriter).
+    OutputBuffer& output() { return write_buffer_; }
 
 private:
-    bool process_buffer();
+    bool read_input();
+    bool parse_input();
+    void submit_batch();
+    // Report the change in buffer capacity since the last call to the
+    // per-thread memory counters (common/memory_stats.hpp).
+    void account_memory();
 
     int fd_;
     SubmitFn submit_fn_;
+    BufferPool& pool_;
 
+    // read_buffer_[0, parsed_) holds the frames already recorded in batch_;
+    // the parser is partway through the frame that starts at parsed_.
     protocol::RespParser parser_;
     std::string read_buffer_;
+    size_t parsed_ = 0;
+    Batch batch_;
 
-    mutable std::mutex write_mutex_;
-    std::string write_buffer_;
+    OutputBuffer write_buffer_;
+    size_t accounted_ = 0;  // buffer bytes last reported
 };
 
 }
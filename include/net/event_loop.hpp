@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace net {
+
+// Readiness bits used for both interest sets and reported events.
+enum EventMask : uint32_t {
+    READABLE = 1u << 0,
+    WRITABLE = 1u << 1,
+};
+
+struct IoEvent {
+    int fd;
+    uint32_t mask;
+};
+
+// Edge-triggered readiness notification. Callers must drain a readable fd
+// (or write until EAGAIN) before waiting again, as no repeat edge is sent.
+//
+// Interest changes made with watch() are coalesced per fd and applied as one
+// batch at the start of the next wait(), so toggling write interest several
+// times in one loop iteration costs at most one kernel update. A watch()
+// that includes WRITABLE always re-arms the write edge.
+class EventLoop {
+public:
+    virtual ~EventLoop() = default;
+
+    virtual bool open() = 0;
+    virtual const char* name() const = 0;
+
+    // Any thread: make a blocked (or the next) wait() return. Wakeups that
+    // arrive before the loop gets to run collapse into one.
+    virtual void wakeup() = 0;
+
+    // Set fd's interest mask (READABLE | WRITABLE). Deferred until wait().
+    void watch(int fd, uint32_t mask);
+
+    // Drop fd immediately, including any queued change. Call before close().
+    void unwatch(int fd);
+
+    // Apply queued changes, then block up to timeout_ms (-1 = forever).
+    // Returns number of events in `out`, or -1 on error (errno set).
+    int wait(std::vector<IoEvent>& out, int timeout_ms);
+
+protected:
+    struct Change {
+        int fd;
+        uint32_t old_mask;
+        uint32_t new_mask;
+    };
+
+    virtual void remove_now(int fd, uint32_t old_mask) = 0;
+    virtual int poll(const std::vector<Change>& changes,
+                     std::vector<IoEvent>& out,
+                     int timeout_ms) = 0;
+
+private:
+    std::unordered_map<int, uint32_t> interest_;  // applied masks
+    std::unordered_map<int, uint32_t> pending_;   // fd -> desired mask
+    std::vector<Change> changes_;
+};
+
+// Backend by name: "epoll", "kqueue", or "" / "auto" for the platform default
+// (epoll on Linux, kqueue on BSD/macOS). Returns nullptr if unavailable.
+std::unique_ptr<EventLoop> make_event_loop(const std::string& backend);
+
+} // namespace net
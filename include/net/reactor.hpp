@@ -0,0 +1,181 @@
+#pragma once
+
+#include <unordered_map>
+#include <memory>
+#include <set>
+#include <deque>
+#include <atomic>
+#include <chrono>
+#include <string>
+
+#if defined(__linux__)
+#include <sys/socket.h>
+#endif
+
+#include "storage/storage_engine.hpp"
+#include "net/buffer.hpp"
+#include "net/connection.hpp"
+#include "net/event_loop.hpp"
+#include "net/uring.hpp"
+#include "concurrency/thread_pool.hpp"
+#include "concurrency/spsc_queue.hpp"
+#include "concurrency/mpsc_queue.hpp"
+#include "protocol/executor.hpp"
+
+namespace net {
+
+// One network event loop: accepts on its listener, owns the connections it
+// accepted, and parses their requests. Each read's commands run on the shared
+// pool as one ordered batch and its replies come back as one buffer through
+// this reactor's lock-free completion queue, with at most one wakeup per loop
+// iteration however many workers finish. Under appendfsync always, a
+// connection's output is held back until the AOF fsync covering its latest
+// write completes.
+class Reactor {
+public:
+    Reactor(const std::string& io_backend,
+            mini_redis::StorageEngine& storage,
+            mini_redis::concurrency::ThreadPool& pool);
+
+    ~Reactor();
+
+    bool start(int listen_fd);
+    void run();
+    const char* backend_name() const;
+
+    // Shared-nothing mode: this reactor becomes core `core` of `peers`.
+    // Commands run inline on this thread when their keys live in shards it
+    // owns; anything else is forwarded to the owning core over an SPSC ring
+    // and the reply comes back the same way. Call on every reactor before run().
+    void join_mesh(size_t core, const std::vector<Reactor*>& peers);
+
+    // Any thread: wake run() out of its wait. Coalesced until run() next
+    // drains its queues.
+    void notify();
+
+private:
+    struct CoreMessage;
+    struct FanOut;
+
+    // Per-connection ordering in mesh mode: while a forwarded command is
+    // outstanding, later commands from the same client wait in backlog.
+    struct MeshConn {
+        uint64_t serial = 0;
+        bool waiting = false;
+        std::deque<std::vector<std::string>> backlog;
+    };
+
+    // Pool mode: at most one batch per connection is on the pool at a time,
+    // so pipelined replies keep request order. Commands parsed meanwhile are
+    // collected into the next batch.
+    struct PoolConn {
+        uint64_t serial = 0;
+        bool busy = false;
+        Connection::Batch next;
+    };
+
+    void pool_dispatch(int fd, Connection::Batch batch);
+    void submit_batch(int fd, PoolConn& pc, Connection::Batch batch);
+
+    void mesh_dispatch(int fd, Connection::Batch batch);
+    void mesh_route(int fd, MeshConn& mc, mini_redis::protocol::CommandArgs cmd);
+    void mesh_post(size_t core, CoreMessage* msg);
+    void mesh_finish(int fd, uint64_t serial, OutputBuffer reply, uint64_t lsn);
+    bool mesh_poll();
+    int mesh_expire();
+    void mesh_notify_peers();
+
+    void accept_clients();
+    void push_pending_response(int fd, uint64_t serial, OutputBuffer response, std::string spent,
+                               uint64_t lsn);
+    void drain_response_queue();
+    void update_write_interest(int fd, Connection& conn);
+    void deliver(int fd, OutputBuffer response, uint64_t lsn);
+    void hold(int fd, uint64_t lsn);
+    bool is_held(int fd) const { return !held_.empty() && held_.count(fd) != 0; }
+    void release_held();
+    void execute_inline(int fd, mini_redis::protocol::CommandArgs cmd);
+    void output_ready(int fd, Connection& conn);
+    void flush_writes();
+    void add_connection(int fd);
+    void remove_connection(int fd);
+
+    bool start_uring();
+    void run_uring();
+#if defined(MINI_REDIS_HAVE_IO_URING)
+    struct UringConn {
+        static constexpr size_t SEND_IOVS = 16;
+
+        OutputBuffer inflight;  // bytes owned by the in-flight send
+        iovec iov[SEND_IOVS];
+        msghdr msg{};
+        bool sending = false;
+        bool recv_armed = false;
+        bool closing = false;
+    };
+
+    void uring_arm_wake();
+    void uring_arm_accept();
+    void uring_arm_recv(int fd, UringConn& st);
+    void uring_send(int fd, UringConn& st);
+    void uring_close(int fd, UringConn& st);
+    void uring_complete(const io_uring_cqe& cqe);
+    // Arms and sends that found the SQ full, retried once the loop has
+    // submitted and reaped; true if some are still waiting.
+    bool uring_retry_deferred();
+
+    std::unique_ptr<Uring> ring_;
+    int wake_fd_ = -1;      // eventfd read through the ring by notify()
+    uint64_t wake_buf_ = 0;
+    std::unique_ptr<BufferRing> recv_buffers_;
+    std::unordered_map<int, UringConn> uring_conns_;
+    std::vector<int> uring_rearm_;   // recv to arm (ring ran dry, or no SQE)
+    std::vector<int> uring_resend_;  // send to start (no SQE)
+    bool uring_wake_deferred_ = false;
+    bool uring_accept_deferred_ = false;
+    std::vector<int> uring_dead_;
+#endif
+
+    std::string io_backend_;
+    int listen_fd_;
+    std::unique_ptr<EventLoop> loop_;
+
+    mini_redis::StorageEngine& storage_;
+    mini_redis::concurrency::ThreadPool& pool_;
+
+    struct Completion {
+        int fd;
+        uint64_t serial;  // PoolConn::serial, guards against fd reuse
+        OutputBuffer response;
+        std::string spent;  // the batch's request bytes, back for reuse
+        uint64_t lsn;       // the batch's last AOF record, 0 if it wrote none
+    };
+
+    mini_redis::concurrency::MpscQueue<Completion> completions_;
+    std::atomic<bool> wake_pending_{false};
+
+    BufferPool buffers_;
+    std::unordered_map<int, std::unique_ptr<Connection>> connections_;
+    std::set<int> write_interest_;
+    std::vector<int> flush_list_;  // connections with replies to write this iteration
+    std::unordered_map<int, PoolConn> pool_conns_;
+
+    // appendfsync always: the AOF, and for each connection with output held
+    // back, the LSN that must be durable before it goes out.
+    mini_redis::AOFWriter* aof_ = nullptr;
+    std::unordered_map<int, uint64_t> held_;
+
+    bool mesh_ = false;
+    size_t core_ = 0;
+    std::vector<Reactor*> peers_;
+    // inbox_[c] carries messages from core c; outbox_[c] holds messages for
+    // core c that did not fit in its inbox yet.
+    std::vector<std::unique_ptr<mini_redis::concurrency::SpscQueue<CoreMessage*>>> inbox_;
+    std::vector<std::vector<CoreMessage*>> outbox_;
+    std::vector<bool> peer_needs_notify_;
+    std::unordered_map<int, MeshConn> mesh_conns_;
+    uint64_t next_serial_ = 0;
+    std::chrono::steady_clock::time_point next_expire_{};
+};
+
+}
@@ -1,23 +1,23 @@
 #pragma once
 
-#include <unordered_map>
 #include <memory>
-#include <set>
-#include <queue>
-#include <mutex>
-#include <sys/event.h>
+#include <thread>
+#include <vector>
 
+#include "common/config.hpp"
 #include "storage/storage_engine.hpp"
-#include "net/connection.hpp"
+#include "net/reactor.hpp"
 #include "concurrency/thread_pool.hpp"
 
 namespace net {
 
+// Runs config.net_threads reactors. On Linux each reactor gets its own
+// SO_REUSEPORT listener so the kernel spreads connections across them;
+// elsewhere they share one listener and race for accepts.
 class Server {
 public:
-    Server(int port,
-          mini_redis::StorageEngine& storage,
-          size_t worker_threads = 4);
+    Server(const mini_redis::ServerConfig& config,
+          mini_redis::StorageEngine& storage);
 
     ~Server();
 
@@ -25,23 +25,13 @@ public:
     void run();
 
 private:
-    void accept_client();
-    void submit_command(int fd, std::vector<std::string> cmd);
-    void push_pending_response(int fd, std::string response);
-    void drain_response_queue(std::vector<struct kevent>& changelist);
-
-    int port_;
-    int listen_fd_;
-    int kq_;
-
+    mini_redis::ServerConfig config_;
     mini_redis::StorageEngine& storage_;
     mini_redis::concurrency::ThreadPool pool_;
 
-    std::mutex response_mutex_;
-    std::queue<std::pair<int, std::string>> response_queue_;
-
-    std::unordered_map<int, std::unique_ptr<Connection>> connections_;
-    std::set<int> write_interest_;
+    std::vector<int> listen_fds_;
+    std::vector<std::unique_ptr<Reactor>> reactors_;
+    std::vector<std::thread> threads_;
 };
 
 }
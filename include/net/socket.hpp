@@ -0,0 +1,25 @@
+#pragma once
+
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include <cstddef>
+
+namespace net {
+
+void set_nonblocking(int fd);
+
+// Bound, listening, non-blocking TCP socket on INADDR_ANY:port, or -1.
+// With reuse_port, several listeners may bind the same port (SO_REUSEPORT)
+// and the kernel load-balances incoming connections between them.
+int open_listener(int port, bool reuse_port);
+
+// Accept one pending connection as a non-blocking socket.
+// Returns -1 with errno set (EAGAIN once the backlog is drained).
+int accept_nonblocking(int listen_fd);
+
+// Scatter-gather send of iov[0, count). Like writev, but a peer that has
+// gone away yields EPIPE instead of SIGPIPE where the platform allows.
+ssize_t send_iov(int fd, const iovec* iov, size_t count);
+
+} // namespace net
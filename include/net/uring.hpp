@@ -0,0 +1,108 @@
+#pragma once
+
+// Minimal io_uring binding over the raw syscalls (no liburing dependency).
+// Only what the server needs: SQE/CQE rings and one provided-buffer ring.
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#if defined(IORING_RECV_MULTISHOT)
+#define MINI_REDIS_HAVE_IO_URING 1
+#endif
+#endif
+
+#if defined(MINI_REDIS_HAVE_IO_URING)
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace net {
+
+class Uring {
+public:
+    Uring() = default;
+    ~Uring();
+
+    Uring(const Uring&) = delete;
+    Uring& operator=(const Uring&) = delete;
+
+    bool init(unsigned sq_entries, unsigned cq_entries);
+
+    // Next free SQE, zeroed. Flushes the queue to the kernel if it is full.
+    io_uring_sqe* get_sqe();
+
+    // Submit everything queued and wait for at least wait_nr completions,
+    // giving up after timeout_ms if that is non-negative.
+    int submit_and_wait(unsigned wait_nr, int timeout_ms = -1);
+
+    // Visit all ready CQEs, then release them to the kernel in one store.
+    template <typename F>
+    unsigned drain_completions(F&& fn) {
+        unsigned head = *cq_head_;
+        unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        unsigned count = tail - head;
+        for (; head != tail; ++head)
+            fn(cqes_[head & *cq_mask_]);
+        __atomic_store_n(cq_head_, tail, __ATOMIC_RELEASE);
+        return count;
+    }
+
+    int fd() const { return ring_fd_; }
+
+private:
+    int ring_fd_ = -1;
+
+    void* sq_ptr_ = nullptr;
+    size_t sq_len_ = 0;
+    void* cq_ptr_ = nullptr;
+    size_t cq_len_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    size_t sqes_len_ = 0;
+
+    unsigned* sq_head_ = nullptr;
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_mask_ = nullptr;
+    unsigned* sq_array_ = nullptr;
+    unsigned sq_entries_ = 0;
+    unsigned sq_local_tail_ = 0;
+    unsigned to_submit_ = 0;
+
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned* cq_mask_ = nullptr;
+    io_uring_cqe* cqes_ = nullptr;
+};
+
+// Provided-buffer ring: the kernel picks a buffer for each multishot recv
+// completion; we hand it back with recycle() once its bytes are consumed.
+class BufferRing {
+public:
+    BufferRing() = default;
+    ~BufferRing();
+
+    BufferRing(const BufferRing&) = delete;
+    BufferRing& operator=(const BufferRing&) = delete;
+
+    // count must be a power of two.
+    bool init(Uring& ring, uint16_t group_id, unsigned count, unsigned buf_size);
+
+    uint16_t group_id() const { return group_id_; }
+    const char* buffer(uint16_t bid) const { return storage_.data() + size_t(bid) * buf_size_; }
+
+    // Queue bid for reuse; visible to the kernel after the next publish().
+    void recycle(uint16_t bid);
+    void publish();
+
+private:
+    io_uring_buf* bufs_ = nullptr;
+    size_t ring_len_ = 0;
+    std::vector<char> storage_;
+    unsigned count_ = 0;
+    unsigned buf_size_ = 0;
+    uint16_t group_id_ = 0;
+    uint16_t tail_ = 0;
+};
+
+} // namespace net
+
+#endif // MINI_REDIS_HAVE_IO_URING
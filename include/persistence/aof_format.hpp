@@ -0,0 +1,86 @@
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+
+#include <unistd.h>
+
+#include <cerrno>
+
+#include "common/crc32c.hpp"
+
+namespace mini_redis::aof {
+
+// One AOF record: the command as a RESP array of bulk strings, exactly as a
+// client would send it, then "+<crc>\r\n" with the CRC-32C of the array's
+// bytes in 8 hex digits. Keys and values are binary-safe; a record cut short
+// or damaged by a crash fails its checksum.
+//
+// Files from before this format hold text lines ("SET k v\n"); a record
+// starts with '*', a line never does. A file may hold lines followed by
+// records (one written by an older server, then appended to), never lines
+// after a record: there, a byte other than '*' is damage.
+constexpr size_t CHECKSUM_BYTES = 11;
+
+inline void append_record(std::string& out, std::initializer_list<std::string_view> args) {
+    auto number = [&](char prefix, size_t n) {
+        char buf[24];
+        buf[0] = prefix;
+        char* end = std::to_chars(buf + 1, buf + sizeof(buf) - 2, n).ptr;
+        *end++ = '\r';
+        *end++ = '\n';
+        out.append(buf, static_cast<size_t>(end - buf));
+    };
+    size_t start = out.size();
+    number('*', args.size());
+    for (std::string_view a : args) {
+        number('$', a.size());
+        out.append(a).append("\r\n");
+    }
+    uint32_t crc = crc32c(out.data() + start, out.size() - start);
+    char trailer[CHECKSUM_BYTES] = {'+'};
+    for (int i = 0; i < 8; ++i)
+        trailer[8 - i] = "0123456789abcdef"[(crc >> (4 * i)) & 0xf];
+    trailer[9] = '\r';
+    trailer[10] = '\n';
+    out.append(trailer, CHECKSUM_BYTES);
+}
+
+// Whether `trailer` (CHECKSUM_BYTES long) is the checksum of `frame`.
+inline bool checksum_matches(std::string_view frame, std::string_view trailer) {
+    if (trailer.size() != CHECKSUM_BYTES || trailer[0] != '+' || trailer[9] != '\r' ||
+        trailer[10] != '\n')
+        return false;
+    uint32_t expected = 0;
+    auto [end, ec] = std::from_chars(trailer.data() + 1, trailer.data() + 9, expected, 16);
+    return ec == std::errc() && end == trailer.data() + 9 &&
+           crc32c(frame.data(), frame.size()) == expected;
+}
+
+// write() all of `data` to `fd`, retrying short writes; false on error.
+inline bool write_all(int fd, std::string_view data) {
+    while (!data.empty()) {
+        ssize_t n = ::write(fd, data.data(), data.size());
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        data.remove_prefix(static_cast<size_t>(n));
+    }
+    return true;
+}
+
+inline bool sync_file(int fd) {
+#if defined(__linux__)
+    return fdatasync(fd) == 0;
+#else
+    return fsync(fd) == 0;
+#endif
+}
+
+} // namespace mini_redis::aof
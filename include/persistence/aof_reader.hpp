@@ -1,19 +1,33 @@
 #pragma once
 
+#include <cstddef>
 #include <string>
 
 namespace mini_redis {
 
 class StorageEngine;
 
+// Replays an AOF (see aof_format.hpp) into a StorageEngine. The file is
+// mapped rather than read, and records are parsed in place by the same
+// RespParser that reads client requests, then applied in parallel by
+// lanes that each own a slice of the shards.
 class AOFReader {
 public:
     explicit AOFReader(const std::string& filename);
 
-    void replay(StorageEngine& engine);
+    // A missing file is an empty log. Damage that runs to the end of the
+    // file (a record cut short by a crash, or zeroed pages after it) is
+    // dropped and the file truncated to the last good record; damage
+    // followed by more records is corruption, and replay returns false
+    // having applied the records before it. Text lines of the older format
+    // are read only before the first record.
+    bool replay(StorageEngine& engine);
+
+    size_t records() const { return records_; }
 
 private:
     std::string filename_;
+    size_t records_ = 0;
 };
 
 } // namespace mini_redis
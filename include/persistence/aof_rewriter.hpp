@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "storage/shard.hpp"
+
+namespace mini_redis {
+
+class AOFWriter;
+
+// BGREWRITEAOF: writes a new AOF holding one record per live key and swaps
+// it in for the old one, which otherwise only grows.
+//
+// The writer first starts copying aside every record it writes. The
+// background cycles then snapshot one shard at a time (see
+// StorageEngine::active_aof_rewrite: under the shard's lock, or on its
+// owning core in mesh mode) and this class's thread encodes the snapshots
+// into the new file, followed by the records copied aside. A write both in
+// a snapshot and among those records is applied twice on replay, which
+// leaves the same state. Last, the writer's thread appends what is left
+// and renames the new file over the old between two of its rounds, so no
+// command waits on the rewrite.
+class AOFRewriter {
+public:
+    AOFRewriter(AOFWriter& writer, std::string filename, size_t shards);
+    // Abandons a rewrite under way.
+    ~AOFRewriter();
+
+    AOFRewriter(const AOFRewriter&) = delete;
+    AOFRewriter& operator=(const AOFRewriter&) = delete;
+
+    // Starts a rewrite; false if one is already under way.
+    bool start();
+    bool in_progress();
+
+    // Automatic rewrites: once the file is at least `min_bytes` and has
+    // grown by `percentage` percent since it was opened or last rewritten
+    // (0 turns them off). Background cycles call start_if_due().
+    void set_auto(size_t percentage, size_t min_bytes) {
+        auto_percentage_ = percentage;
+        auto_min_bytes_ = min_bytes;
+    }
+    void start_if_due();
+
+    // Background cycles: while snapshotting(), claim() a shard the caller
+    // may touch, snapshot it and deliver() the copy. claim() is false when
+    // the shard is done or enough snapshots already wait to be written.
+    bool snapshotting() const { return snapshotting_.load(std::memory_order_relaxed); }
+    bool claim(size_t shard);
+    void deliver(Shard::Snapshot snapshot);
+
+    uint64_t rewrites() const { return rewrites_.load(std::memory_order_relaxed); }
+    bool last_ok() const { return last_ok_.load(std::memory_order_relaxed); }
+
+private:
+    void run();
+    bool rewrite();
+    // Snapshots, in the order they arrive; false if stopped first.
+    bool write_snapshots(int fd);
+
+    AOFWriter& writer_;
+    std::string filename_;
+    size_t shards_;
+    size_t auto_percentage_ = 0;
+    size_t auto_min_bytes_ = 0;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool running_ = false;
+    bool stopping_ = false;
+    std::vector<bool> claimed_;
+    std::deque<Shard::Snapshot> ready_;  // delivered, not yet written
+    std::atomic<bool> snapshotting_{false};
+
+    std::atomic<uint64_t> rewrites_{0};
+    std::atomic<bool> last_ok_{true};
+    std::atomic<uint64_t> failed_at_ms_{0};
+
+    std::thread thread_;
+};
+
+} // namespace mini_redis
@@ -1,27 +1,167 @@
 #pragma once
 
 #include <string>
-#include <fstream>
+#include <string_view>
 #include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include <memory>
 #include <cstdint>
+#include <vector>
 
 namespace mini_redis {
 
+// When the AOF is fsynced (appendfsync).
+enum class AofFsync : uint8_t {
+    ALWAYS,    // before the write's reply is sent (group commit)
+    EVERYSEC,  // at most once a second: a crash loses up to a second
+    NO,        // never; the OS writes the pages back when it likes
+};
+
+inline bool parse_aof_fsync(std::string_view name, AofFsync& out) {
+    if (name == "always") out = AofFsync::ALWAYS;
+    else if (name == "everysec") out = AofFsync::EVERYSEC;
+    else if (name == "no") out = AofFsync::NO;
+    else return false;
+    return true;
+}
+
+inline std::string_view aof_fsync_name(AofFsync policy) {
+    switch (policy) {
+    case AofFsync::ALWAYS: return "always";
+    case AofFsync::NO: return "no";
+    default: return "everysec";
+    }
+}
+
+// Appends never touch the file. Each thread encodes its records (see
+// aof_format.hpp) into its own staging buffer, stamped with a global log
+// sequence number (LSN); a background thread gathers every stage, merges
+// the records back into LSN order and writes them with one write() per
+// round, then fsyncs as the policy says.
+// Under `always` the fsync covers the whole round, so concurrent writers
+// share it: callers read thread_lsn() after a write and hold its reply
+// until durable_lsn() reaches it (listeners are told when it moves).
+//
+// A rewrite (see AOFRewriter) swaps in a new file between two rounds:
+// while it runs, every record written is also copied aside for it.
 class AOFWriter {
 public:
-    AOFWriter(const std::string& filename, bool flush_on_each = true);
+    AOFWriter(const std::string& filename, AofFsync policy = AofFsync::EVERYSEC);
+    // Writes out everything staged and fsyncs.
+    ~AOFWriter();
+
+    bool is_open() const { return fd_ >= 0; }
+    AofFsync fsync_policy() const { return policy_; }
+
+    void append_set(std::string_view key, std::string_view value);
+    // Expiry is logged as an absolute Unix-ms time, so replay does not
+    // restart the TTL.
+    void append_set_expire_at(std::string_view key, std::string_view value, uint64_t expire_at_ms);
+    void append_del(std::string_view key);
+    void append_expire_at(std::string_view key, uint64_t expire_at_ms);
+    // FLUSHALL is logged shard by shard, each record while the shard is
+    // still locked (see StorageEngine::flush_all), as "FLUSHSHARD i n":
+    // shard i of n, so replay under another shard count can map it.
+    void append_flush_shard(size_t shard, size_t shards);
+
+    // LSN of the calling thread's latest append (0 before its first).
+    static uint64_t thread_lsn();
+    // Every record up to this LSN is in the file, and fsynced under `always`.
+    uint64_t durable_lsn() const { return durable_lsn_.load(std::memory_order_acquire); }
+    // Called on the writer thread whenever durable_lsn() advances.
+    void on_durable(std::function<void()> fn);
+
+    uint64_t writes() const { return writes_.load(std::memory_order_relaxed); }
+    uint64_t fsyncs() const { return fsyncs_.load(std::memory_order_relaxed); }
+    // Size of the file, and its size when opened or last rewritten.
+    uint64_t file_bytes() const { return file_bytes_.load(std::memory_order_relaxed); }
+    uint64_t base_bytes() const { return base_bytes_.load(std::memory_order_relaxed); }
+
+    // Returns once every record not yet merged, and so every write applied
+    // from now on, is also copied aside; false if a rewrite already is.
+    bool begin_rewrite();
+    // Appends the records copied aside so far to `out`.
+    void take_rewritten(std::string& out);
+    // Has the writer thread append the rest to `fd` (the new file at `path`,
+    // opened O_APPEND), fsync it and rename it over the AOF, then carry on in
+    // it. Takes `fd` either way; on failure the new file is removed and the
+    // old one kept. Blocks until done.
+    bool finish_rewrite(int fd, const std::string& path);
+    void abort_rewrite();
 
-    void append_set(const std::string& key, const std::string& value);
-    void append_setex(const std::string& key, uint64_t ttl, const std::string& value);
-    void append_del(const std::string& key);
-    void append_expire(const std::string& key, uint64_t ttl_seconds);
+    AOFWriter(const AOFWriter&) = delete;
+    AOFWriter& operator=(const AOFWriter&) = delete;
 
 private:
-    void maybe_flush();
+    struct Record {
+        uint64_t lsn;
+        size_t end;  // offset just past the record in its buffer
+    };
+    // One thread's records, in LSN order.
+    struct Stage {
+        std::mutex mutex;
+        std::string bytes;
+        std::vector<Record> records;
+    };
+    // What the writer took from a stage and has not written yet.
+    struct Taken {
+        std::string bytes;
+        std::vector<Record> records;
+        size_t next = 0;  // first record not merged
+    };
+
+    enum class Rewrite : uint8_t { NONE, REQUESTED, CAPTURING, SWAP };
+
+    Stage& stage();
+    void append(std::initializer_list<std::string_view> args);
+    void run();
+    void gather();
+    bool write_out();
+    bool swap_file();
+    void account();
+
+    std::string filename_;
+    int fd_ = -1;
+    AofFsync policy_;
+    uint64_t id_;  // tells this writer's stages apart in thread-local state
+
+    std::atomic<uint64_t> next_lsn_{0};
+    std::atomic<uint64_t> durable_lsn_{0};
+    std::atomic<bool> pending_{false};  // appended since the writer last looked
+
+    std::mutex mutex_;  // stages_, listeners_, stopping_, rewrite_*
+    std::condition_variable cv_;
+    std::vector<std::unique_ptr<Stage>> stages_;
+    std::vector<std::function<void()>> listeners_;
+    bool stopping_ = false;
+    Rewrite rewrite_ = Rewrite::NONE;
+    std::condition_variable rewrite_cv_;  // rewrite_ moved on
+    int rewrite_fd_ = -1;
+    std::string rewrite_path_;
+    bool rewrite_ok_ = false;
+
+    std::mutex captured_mutex_;
+    std::string captured_;  // records written since begin_rewrite()
+
+    // Writer thread only.
+    std::vector<Taken> taken_;
+    std::string out_;         // merged records not yet written
+    size_t out_written_ = 0;  // bytes of out_ already in the file
+    uint64_t out_lsn_ = 0;    // last LSN merged into out_
+    uint64_t synced_lsn_ = 0;
+    size_t staged_bytes_ = 0; // stage and taken_ buffers, as of gather()
+    size_t accounted_ = 0;    // bytes reported as AOF_BUFFER
+    bool capturing_ = false;  // copying merged records to captured_
+
+    std::atomic<uint64_t> writes_{0};
+    std::atomic<uint64_t> fsyncs_{0};
+    std::atomic<uint64_t> file_bytes_{0};
+    std::atomic<uint64_t> base_bytes_{0};
 
-    std::ofstream file_;
-    std::mutex mutex_;
-    bool flush_on_each_;
+    std::thread thread_;  // last: starts once the rest is set up
 };
 
 } // namespace mini_redis
@@ -1,21 +1,59 @@
 #pragma once
 
-#include <string>
-#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+namespace protocol {
+class ResponseWriter;
+}
+
+namespace mini_redis {
+class StorageEngine;
+}
 
 namespace mini_redis::protocol {
 
-enum class CommandType {
-    GET,
-    SET,
-    SETEX,
-    DEL,
-    UNKNOWN
+// Command name followed by its arguments, viewing bytes owned by the caller.
+using CommandArgs = std::span<const std::string_view>;
+
+using CommandHandler = void (*)(mini_redis::StorageEngine& storage,
+                                CommandArgs cmd,
+                                ::protocol::ResponseWriter& out);
+
+enum CommandFlag : uint32_t {
+    CMD_READ = 1u << 0,        // reads the keyspace
+    CMD_WRITE = 1u << 1,       // modifies the keyspace (persisted)
+    CMD_SLOW = 1u << 2,        // cost grows with the data set, not the request
+    CMD_MULTI_KEY = 1u << 3,   // keys may live in several shards
+    CMD_ALL_SHARDS = 1u << 4,  // operates on every shard (e.g. KEYS)
+    CMD_CURSOR = 1u << 5,      // argv[1] is a SCAN cursor naming the shard to run on
 };
 
-struct Command {
-    CommandType type{CommandType::UNKNOWN};
-    std::vector<std::string> args;
+struct CommandSpec {
+    std::string_view name;  // upper case
+    int arity;              // exact argc including the name, or -N for at least N
+    uint32_t flags;
+    int first_key;          // argv index of the first key; 0 = no keys
+    int last_key;           // argv index of the last key; -1 = last argument
+    CommandHandler handler;
+
+    bool arity_ok(size_t argc) const {
+        return arity >= 0 ? argc == static_cast<size_t>(arity)
+                          : argc >= static_cast<size_t>(-arity);
+    }
+
+    // Key arguments are argv[keys_begin, keys_end(argc)).
+    size_t keys_begin() const { return static_cast<size_t>(first_key); }
+    size_t keys_end(size_t argc) const {
+        if (first_key == 0) return 0;
+        return last_key < 0 ? argc : static_cast<size_t>(last_key) + 1;
+    }
 };
 
+// Case-insensitive lookup through a perfect hash computed at compile time:
+// one hash, one slot, one compare. Returns nullptr for unknown commands.
+const CommandSpec* lookup_command(std::string_view name);
+
 } // namespace mini_redis::protocol
@@ -1,16 +1,14 @@
 #pragma once
 
-#include <string>
-#include <vector>
-
-namespace mini_redis {
-class StorageEngine;
-}
+#include "protocol/command.hpp"
+#include "protocol/response.hpp"
 
 namespace mini_redis::protocol {
 
-// Execute a single command and return RESP response string. Thread-safe if storage is.
-std::string execute_command(mini_redis::StorageEngine& storage,
-                            const std::vector<std::string>& cmd);
+// Execute a single command through the command table, appending its RESP
+// reply to `out`. Thread-safe if storage is.
+void execute_command(mini_redis::StorageEngine& storage,
+                     CommandArgs cmd,
+                     ::protocol::ResponseWriter& out);
 
 } // namespace mini_redis::protocol
@@ -1,14 +1,89 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
+#include <span>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace protocol {
 
+// Incremental RESP request parser. Arguments are reported as offsets into
+// the caller's buffer and never copied. All state is kept relative to the
+// start of the current frame, so a frame that arrives over many reads is
+// scanned once in total, and the caller may move or discard the bytes
+// before the frame between calls.
 class RespParser {
 public:
-    bool parse_array(const std::string& in,
-                     size_t& pos,
-                     std::vector<std::string>& out);
+    enum class Status { COMPLETE, INCOMPLETE, ERROR };
+
+    struct Arg {
+        size_t offset;  // from the start of the frame
+        size_t length;
+    };
+
+    // `frame` starts at the first byte of the current frame and holds
+    // everything received since. After INCOMPLETE, call again with the same
+    // frame start once more bytes arrive. After COMPLETE, args() and
+    // frame_size() describe the command until the next call, which begins
+    // a new frame. ERROR means the stream is not valid RESP.
+    Status parse(std::string_view frame);
+
+    const std::vector<Arg>& args() const { return args_; }
+    size_t frame_size() const { return scanned_; }
+
+    // Once a bulk header has been read: the frame size needed to finish that
+    // argument, so the caller can size its buffer for large payloads up front.
+    // 0 when unknown.
+    size_t bytes_needed() const;
+
+private:
+    Status read_length(std::string_view frame, char prefix, int64_t& out);
+
+    std::vector<Arg> args_;
+    size_t scanned_ = 0;       // bytes of the frame consumed so far
+    int64_t remaining_ = -1;   // arguments still to read; -1 = need array header
+    int64_t bulk_len_ = -1;    // current argument length; -1 = need bulk header
+    bool done_ = false;
+};
+
+// Commands parsed from one read. Owns the request bytes, and records each
+// argument as an offset into them, so a batch can be moved to another thread
+// without copying payloads or invalidating views.
+class CommandBatch {
+public:
+    bool empty() const { return ends_.empty(); }
+    size_t size() const { return ends_.size(); }
+
+    // Record the command the parser just completed at data()[frame_offset].
+    void add(size_t frame_offset, const std::vector<RespParser::Arg>& args);
+
+    // Take ownership of the bytes every added offset refers to; give them
+    // back once the batch has run so the buffer can be reused.
+    void adopt(std::string& bytes) { data_.swap(bytes); }
+    std::string release() { return std::move(data_); }
+
+    // Append other's commands after this batch's, keeping order.
+    void append(CommandBatch&& other);
+
+    // Call fn(std::span<const std::string_view>) for each command in order.
+    template <typename F>
+    void for_each(F&& fn) const {
+        std::vector<std::string_view> argv;
+        size_t begin = 0;
+        for (size_t end : ends_) {
+            argv.clear();
+            for (size_t i = begin; i < end; ++i)
+                argv.emplace_back(data_.data() + args_[i].offset, args_[i].length);
+            fn(std::span<const std::string_view>(argv));
+            begin = end;
+        }
+    }
+
+private:
+    std::string data_;
+    std::vector<RespParser::Arg> args_;  // offsets into data_
+    std::vector<size_t> ends_;           // one past each command's last arg
 };
 
 }
@@ -1,17 +1,63 @@
 #pragma once
+#include <charconv>
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 
+namespace net {
+class OutputBuffer;
+}
+
+namespace mini_redis {
+class Value;
+}
+
 namespace protocol {
 
-class RespResponse {
+// Fixed replies, shared rather than rebuilt per command.
+inline constexpr std::string_view OK_REPLY = "+OK\r\n";
+inline constexpr std::string_view NULL_REPLY = "$-1\r\n";
+inline constexpr std::string_view PONG_REPLY = "$4\r\nPONG\r\n";
+
+// Serializes RESP replies straight onto the end of an output buffer: no
+// temporary strings, and numbers are formatted with std::to_chars. Writing
+// into an OutputBuffer also lets large stored values go out by reference
+// (see bulk(const Value&)); into a plain string, every byte is copied.
+class ResponseWriter {
 public:
-    static std::string ok();
-    static std::string error(const std::string&);
-    static std::string bulk(const std::string&);
-    static std::string null();
-    static std::string integer(int64_t value);
-    static std::string array(const std::vector<std::string>& elements);
+    explicit ResponseWriter(std::string& out) : out_(&out) {}
+    explicit ResponseWriter(net::OutputBuffer& chain);
+
+    void raw(std::string_view reply) { out_->append(reply); }
+    void ok() { raw(OK_REPLY); }
+    void null() { raw(NULL_REPLY); }
+    void error(std::string_view msg);
+    void integer(int64_t value) { header(':', value); }
+    void bulk(std::string_view value) {
+        header('$', static_cast<int64_t>(value.size()));
+        out_->append(value);
+        out_->append("\r\n", 2);
+    }
+    // Blob values of LINK_MIN_BYTES or more are linked into the chain, not copied.
+    void bulk(const mini_redis::Value& value);
+    void array(const std::vector<std::string>& elements);
+    // Opens an array; the caller writes its `count` elements next.
+    void array_header(size_t count) { header('*', static_cast<int64_t>(count)); }
+
+private:
+    // "<type><value>\r\n"
+    void header(char type, int64_t value) {
+        char buf[24];
+        buf[0] = type;
+        char* end = std::to_chars(buf + 1, buf + sizeof(buf) - 2, value).ptr;
+        *end++ = '\r';
+        *end++ = '\n';
+        out_->append(buf, static_cast<size_t>(end - buf));
+    }
+
+    std::string* out_;
+    net::OutputBuffer* chain_ = nullptr;
 };
 
 }
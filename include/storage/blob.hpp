@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string_view>
+#include <utility>
+
+#include "storage/slab.hpp"
+
+namespace mini_redis {
+
+// Immutable, reference-counted value bytes in one allocation: a 16-byte
+// header followed by the data. A GET takes a reference instead of copying,
+// and the reply can hold it until the socket has sent the bytes, on
+// whichever thread that happens.
+//
+// Blobs stored in a shard come from its SlabArena (when they fit); others,
+// and those the arena could not place, from the heap.
+class Blob {
+public:
+    static Blob* create(std::string_view bytes, SlabArena* arena = nullptr) {
+        size_t n = allocation_size(bytes.size());
+        void* mem = arena ? arena->allocate(n) : nullptr;
+        bool in_slab = mem != nullptr;
+        if (!mem)
+            mem = ::operator new(n);
+        Blob* blob = new (mem) Blob(bytes.size(), in_slab);
+        std::memcpy(blob->data(), bytes.data(), bytes.size());
+        return blob;
+    }
+
+    void retain() { refs_.fetch_add(1, std::memory_order_relaxed); }
+
+    void release() {
+        if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            bool in_slab = in_slab_;
+            this->~Blob();
+            if (in_slab)
+                SlabArena::free(this);
+            else
+                ::operator delete(this);
+        }
+    }
+
+    std::string_view view() const { return {data(), size_}; }
+    size_t size() const { return size_; }
+    bool in_slab() const { return in_slab_; }
+
+    // Heap bytes held by one blob of `n` data bytes.
+    static size_t allocation_size(size_t n) { return sizeof(Blob) + n; }
+
+private:
+    Blob(size_t size, bool in_slab) : in_slab_(in_slab), size_(size) {}
+
+    char* data() { return reinterpret_cast<char*>(this + 1); }
+    const char* data() const { return reinterpret_cast<const char*>(this + 1); }
+
+    std::atomic<uint32_t> refs_{1};
+    bool in_slab_;
+    size_t size_;
+};
+
+static_assert(sizeof(Blob) == 16);
+
+// Owning handle to a Blob: copies share the bytes, the last one frees them.
+class BlobRef {
+public:
+    BlobRef() = default;
+    explicit BlobRef(std::string_view bytes) : blob_(Blob::create(bytes)) {}
+
+    // Adopt one reference already counted for the caller.
+    static BlobRef adopt(Blob* blob) {
+        BlobRef ref;
+        ref.blob_ = blob;
+        return ref;
+    }
+
+    BlobRef(const BlobRef& other) : blob_(other.blob_) {
+        if (blob_) blob_->retain();
+    }
+
+    BlobRef(BlobRef&& other) noexcept : blob_(std::exchange(other.blob_, nullptr)) {}
+
+    BlobRef& operator=(BlobRef other) noexcept {
+        std::swap(blob_, other.blob_);
+        return *this;
+    }
+
+    ~BlobRef() {
+        if (blob_) blob_->release();
+    }
+
+    explicit operator bool() const { return blob_ != nullptr; }
+    std::string_view view() const { return blob_ ? blob_->view() : std::string_view(); }
+
+private:
+    Blob* blob_ = nullptr;
+};
+
+} // namespace mini_redis
@@ -0,0 +1,646 @@
+#pragma once
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <string_view>
+#include <utility>
+
+#include "concurrency/epoch.hpp"
+#include "storage/inline_key.hpp"
+#include "storage/slab.hpp"
+#include "storage/swiss_map.hpp"
+
+namespace mini_redis {
+
+// Swiss-table map from string keys to V with lock-free reads: one writer at
+// a time (the caller serializes them) and any number of concurrent readers.
+//
+// Entries are immutable nodes. A writer publishes a node by storing its
+// pointer into the slot before setting the slot's control byte, so a reader
+// that matches the byte also sees the node. Overwrites and updates swap in
+// a new node; erases clear the slot. Replaced nodes, and whole tables after
+// a rehash, are retired through epoch-based reclamation, so readers must
+// hold a concurrency::EpochGuard while they use anything find() returned.
+//
+// Control bytes are kept 8 to an atomic word (swiss::WordGroup), so readers
+// load a group in one atomic read. Probing is as in SwissMap. Every lookup
+// also takes the key's precomputed Hash, for callers that already have it.
+//
+// Rehashing is incremental, so no single write pays for the whole table.
+// Growing installs an empty table and keeps the previous one as old_, and
+// each write then moves the next REHASH_SLOTS of its slots across
+// (rehash_step() lets an idle writer finish the job). A moved node stays
+// in the old slot as well, and writes keep both copies the same, so a
+// reader that probes the new table, then the old one, finds every key
+// wherever the migration has got to.
+template <typename V, typename Hash = swiss::KeyHash>
+class ConcurrentMap {
+public:
+    struct Node {
+        uint64_t hash;
+        InlineKey key;
+        V value;
+        // Caller-defined access stamp (e.g. for LRU/LFU eviction). Readers
+        // may store to it, so it is only ever approximate.
+        mutable std::atomic<uint32_t> access{0};
+        bool in_slab = false;  // allocated from the map's SlabArena
+    };
+
+    // Bytes held, by kind. The writer keeps the counters; any thread may
+    // read them (relaxed, so a snapshot may mix two writes).
+    struct MemoryUsage {
+        size_t table = 0;   // slot and control arrays
+        size_t nodes = 0;   // sizeof(Node) per entry
+        size_t keys = 0;    // out-of-line key bytes
+        size_t values = 0;  // V::heap_bytes(), when V has one
+
+        size_t total() const { return table + nodes + keys + values; }
+    };
+
+    ConcurrentMap() = default;
+    ~ConcurrentMap() {
+        free_table(table_.load(std::memory_order_relaxed));
+        free_table(old_.load(std::memory_order_relaxed));
+    }
+
+    ConcurrentMap(const ConcurrentMap&) = delete;
+    ConcurrentMap& operator=(const ConcurrentMap&) = delete;
+
+    // false: a single thread does all reads and writes, so unlinked memory
+    // is freed at once instead of waiting for an epoch.
+    void set_deferred_reclaim(bool deferred) { deferred_ = deferred; }
+
+    // Allocate nodes and long keys from `arena` (owned by the caller, which
+    // must be the only thread writing; set while empty). Null: the heap.
+    void set_arena(SlabArena* arena) { arena_ = arena; }
+
+    size_t size() const { return size_.load(std::memory_order_relaxed); }
+    bool empty() const { return size() == 0; }
+    size_t capacity() const {
+        const Table* t = table_.load(std::memory_order_acquire);
+        return t ? t->capacity : 0;
+    }
+
+    // ---- readers (any thread, under an EpochGuard) ----
+
+    const V* find(std::string_view key) const { return find(key, Hash{}(key)); }
+    const V* find(std::string_view key, uint64_t h) const {
+        const Node* n = find_entry(key, h);
+        return n ? &n->value : nullptr;
+    }
+    const Node* find_entry(std::string_view key, uint64_t h) const {
+        // table_ before old_: old_ is published first when a rehash starts.
+        const Table* t = table_.load(std::memory_order_acquire);
+        const Table* old = old_.load(std::memory_order_acquire);
+        for (;;) {
+            if (!t)
+                return nullptr;
+            if (const Node* n = find_node(*t, key, h, std::memory_order_acquire))
+                return n;
+            if (old && old != t)
+                if (const Node* n = find_node(*old, key, h, std::memory_order_acquire))
+                    return n;
+            // A miss holds only if no rehash finished or began meanwhile:
+            // one finishing may have moved the key into t after t was
+            // probed. The epoch pin keeps both tables' addresses from being
+            // reused, so unchanged pointers mean unchanged tables.
+            const Table* t2 = table_.load(std::memory_order_acquire);
+            const Table* old2 = old_.load(std::memory_order_acquire);
+            if (t2 == t && old2 == old)
+                return nullptr;
+            t = t2;
+            old = old2;
+        }
+    }
+
+    // fn(std::string_view key, const V& value) for every entry, in table order.
+    template <typename F>
+    void for_each(F&& fn) const {
+        const Table* t = table_.load(std::memory_order_acquire);
+        if (!t)
+            return;
+        const Table* old = old_.load(std::memory_order_acquire);
+        if (old == t)
+            old = nullptr;
+        if (old)
+            for (size_t i = 0; i < old->capacity; ++i)
+                if (const Node* n = old->slots[i].load(std::memory_order_acquire))
+                    fn(n->key.view(), n->value);
+        for (size_t i = 0; i < t->capacity; ++i) {
+            const Node* n = t->slots[i].load(std::memory_order_acquire);
+            if (n && !in_old(old, *n))
+                fn(n->key.view(), n->value);
+        }
+    }
+
+    // One step of a resumable walk (SCAN): call fn(key, value) for every
+    // entry whose home group (hash & group mask) is the one `cursor` names,
+    // and return the cursor of the next group, 0 after the last.
+    //
+    // Cursors count up in bit-reversed order, as in Redis's dictScan: when
+    // the table doubles, the groups not yet visited are exactly those whose
+    // low bits the cursor has not reached, so no entry present for the
+    // whole walk is missed. Entries may be returned twice. Mid-rehash, a
+    // step covers the cursor's group in the smaller table and every group
+    // it expands to in the larger one, again as dictScan does.
+    template <typename F>
+    uint64_t scan(uint64_t cursor, F&& fn) const {
+        const Table* t = table_.load(std::memory_order_acquire);
+        if (!t)
+            return 0;
+        const Table* old = old_.load(std::memory_order_acquire);
+        auto emit_old = [&](const Node& n) { fn(n.key.view(), n.value); };
+        if (!old || old == t) {
+            uint64_t mask = t->capacity / WIDTH - 1;
+            scan_group(*t, cursor & mask, emit_old);
+            return reverse_bits(reverse_bits(cursor | ~mask) + 1);
+        }
+        // New-table entries also in the old one come from there instead.
+        auto emit = [&](const Node& n) {
+            if (!in_old(old, n))
+                fn(n.key.view(), n.value);
+        };
+        bool old_small = old->capacity <= t->capacity;
+        const Table& small = old_small ? *old : *t;
+        const Table& large = old_small ? *t : *old;
+        uint64_t m0 = small.capacity / WIDTH - 1;
+        uint64_t m1 = large.capacity / WIDTH - 1;
+        if (old_small)
+            scan_group(small, cursor & m0, emit_old);
+        else
+            scan_group(small, cursor & m0, emit);
+        do {
+            if (old_small)
+                scan_group(large, cursor & m1, emit);
+            else
+                scan_group(large, cursor & m1, emit_old);
+            cursor = reverse_bits(reverse_bits(cursor | ~m1) + 1);
+        } while (cursor & (m0 ^ m1));
+        return cursor;
+    }
+
+    // ---- writers (one at a time) ----
+
+    // Insert, or overwrite the existing value. Returns true if key was new.
+    bool insert_or_assign(std::string_view key, V value) {
+        return insert_or_assign(key, Hash{}(key), std::move(value));
+    }
+    bool insert_or_assign(std::string_view key, uint64_t h, V value, uint32_t access = 0) {
+        rehash_step(REHASH_SLOTS);
+        Table* t = table_.load(std::memory_order_relaxed);
+        Slots at = locate(key, h);
+        if (at.found()) {
+            replace(at, make_node(h, key, std::move(value), access));
+            return false;
+        }
+        if (growth_left_ == 0)
+            t = grow();
+        size_t i = find_free(*t, h);
+        if (ctrl_at(*t, i) == swiss::EMPTY)
+            --growth_left_;
+        Node* n = make_node(h, key, std::move(value), access);
+        account(*n, 1);
+        t->slots[i].store(n, std::memory_order_release);
+        set_ctrl(*t, i, h2(h));
+        size_.store(size() + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Copy-on-write update: fn(V&) edits a copy of the value and returns
+    // whether to publish it. Returns false if the key is absent or fn declined.
+    template <typename F>
+    bool update(std::string_view key, uint64_t h, F&& fn) {
+        rehash_step(REHASH_SLOTS);
+        Slots at = locate(key, h);
+        if (!at.found())
+            return false;
+        const Node* old = at.node();
+        V value = old->value;
+        if (!fn(value))
+            return false;
+        replace(at, make_node(old->hash, key, std::move(value),
+                              old->access.load(std::memory_order_relaxed)));
+        return true;
+    }
+
+    // Writer-side compaction: for each entry in slots [start, start +
+    // max_slots), fn(const Node&, V& copy) may edit the copy and returns
+    // whether to publish it in a freshly allocated node (key copied too).
+    // Returns the slot to resume from, 0 after the last. Mid-rehash this
+    // walks the new table only; entries not yet moved wait for a later pass.
+    template <typename F>
+    size_t rebuild_from(size_t start, size_t max_slots, F&& fn) {
+        Table* t = table_.load(std::memory_order_relaxed);
+        Table* old = old_.load(std::memory_order_relaxed);
+        if (!t || start >= t->capacity)
+            return 0;
+        size_t end = start + std::min(max_slots, t->capacity - start);
+        for (size_t i = start; i < end; ++i) {
+            const Node* n = t->slots[i].load(std::memory_order_relaxed);
+            if (!n)
+                continue;
+            V value = n->value;
+            if (fn(*n, value)) {
+                Slots at{i, old ? find_index(*old, n->key.view(), n->hash) : NPOS, this};
+                replace(at, make_node(n->hash, n->key.view(), std::move(value),
+                                      n->access.load(std::memory_order_relaxed)));
+            }
+        }
+        return end < t->capacity ? end : 0;
+    }
+
+    // Writer-side sampling: fn(const Node&) for the occupied slots among the
+    // `max_slots` that follow `start` (wrapping), until fn returns false.
+    // Mid-rehash the old table's unmoved slots are sampled too.
+    template <typename F>
+    void visit_from(size_t start, size_t max_slots, F&& fn) const {
+        const Table* t = table_.load(std::memory_order_relaxed);
+        if (!t)
+            return;
+        for (size_t k = 0; k < max_slots && k < t->capacity; ++k) {
+            const Node* n = t->slots[(start + k) & (t->capacity - 1)].load(std::memory_order_relaxed);
+            if (n && !fn(static_cast<const Node&>(*n)))
+                return;
+        }
+        const Table* old = old_.load(std::memory_order_relaxed);
+        if (!old)
+            return;
+        for (size_t k = 0; k < max_slots && k < old->capacity; ++k) {
+            size_t i = (start + k) & (old->capacity - 1);
+            const Node* n = i >= old->moved ? old->slots[i].load(std::memory_order_relaxed) : nullptr;
+            if (n && !fn(static_cast<const Node&>(*n)))
+                return;
+        }
+    }
+
+    bool erase(std::string_view key) { return erase(key, Hash{}(key)); }
+    bool erase(std::string_view key, uint64_t h) {
+        rehash_step(REHASH_SLOTS);
+        Slots at = locate(key, h);
+        if (!at.found())
+            return false;
+        Node* node = nullptr;
+        if (at.cur != NPOS && unlink(*table_.load(std::memory_order_relaxed), at.cur, node))
+            ++growth_left_;
+        if (at.old != NPOS) {
+            unlink(*old_.load(std::memory_order_relaxed), at.old, node);
+            if (at.cur == NPOS)
+                ++growth_left_;  // no longer waiting to be moved
+        }
+        account(*node, -1);
+        size_.store(size() - 1, std::memory_order_relaxed);
+        reclaim(node, delete_node);
+        return true;
+    }
+
+    void clear() {
+        Table* t = table_.exchange(nullptr, std::memory_order_acq_rel);
+        Table* old = old_.exchange(nullptr, std::memory_order_acq_rel);
+        size_.store(0, std::memory_order_relaxed);
+        growth_left_ = 0;
+        store(table_bytes_, 0);
+        store(key_bytes_, 0);
+        store(value_bytes_, 0);
+        if (t)
+            reclaim(t, free_table_with_nodes);
+        if (old)
+            reclaim(old, free_table_with_nodes);
+    }
+
+    // Move up to `slots` more of the old table's slots into the new one.
+    // Writes do this as they go; an idle writer may call it to finish a
+    // rehash sooner. Returns whether one is still under way.
+    bool rehash_step(size_t slots) {
+        Table* old = old_.load(std::memory_order_relaxed);
+        if (!old)
+            return false;
+        Table* t = table_.load(std::memory_order_relaxed);
+        size_t end = std::min(old->capacity, old->moved + slots);
+        for (size_t j = old->moved; j < end; ++j) {
+            Node* n = old->slots[j].load(std::memory_order_relaxed);
+            if (!n)
+                continue;
+            // Room for every node still to move was reserved at the start.
+            size_t i = find_free(*t, n->hash);
+            if (ctrl_at(*t, i) == swiss::DELETED)
+                ++growth_left_;
+            t->slots[i].store(n, std::memory_order_release);
+            set_ctrl(*t, i, h2(n->hash));
+        }
+        old->moved = end;
+        if (end < old->capacity)
+            return true;
+        old_.store(nullptr, std::memory_order_release);
+        store(table_bytes_, t->capacity * SLOT_BYTES);
+        reclaim(old, free_table_arrays);
+        return false;
+    }
+    bool rehashing() const { return old_.load(std::memory_order_relaxed) != nullptr; }
+
+    MemoryUsage memory_usage() const {
+        MemoryUsage m;
+        m.table = table_bytes_.load(std::memory_order_relaxed);
+        m.nodes = size() * sizeof(Node);
+        m.keys = key_bytes_.load(std::memory_order_relaxed);
+        m.values = value_bytes_.load(std::memory_order_relaxed);
+        return m;
+    }
+    size_t memory_bytes() const { return memory_usage().total(); }
+
+    // What one entry costs: its node, its slot and control byte, and its
+    // out-of-line bytes.
+    static size_t entry_bytes(const Node& n) {
+        return sizeof(Node) + SLOT_BYTES + n.key.heap_bytes() + value_heap_bytes(n.value);
+    }
+
+private:
+    static constexpr size_t NPOS = static_cast<size_t>(-1);
+    static constexpr size_t WIDTH = swiss::WordGroup::WIDTH;
+    static constexpr size_t MIN_CAPACITY = 2 * WIDTH;
+    static constexpr size_t SLOT_BYTES = sizeof(std::atomic<Node*>) + 1;
+    // Old-table slots each write moves mid-rehash. A doubled table takes
+    // capacity / 2 inserts to fill and a same-size one (clearing
+    // tombstones) capacity / 4, so the old table always drains first.
+    static constexpr size_t REHASH_SLOTS = 16;
+
+    // ctrl and slots share one anonymous mapping, so a new table costs the
+    // same at any size: its pages are zero until first touched, and control
+    // words are stored XORed with ALL_EMPTY so that zero reads as EMPTY.
+    struct Table {
+        size_t capacity;   // slots; a power of two, multiple of WIDTH
+        std::atomic<uint64_t>* ctrl;   // capacity / WIDTH words
+        std::atomic<Node*>* slots;     // nullptr when not full
+        // As old_: slots [0, moved) are in the new table too, which owns
+        // their nodes.
+        size_t moved = 0;
+    };
+
+    // Where a writer found a key: a slot in table_, in old_, or both (a
+    // moved node, mirrored).
+    struct Slots {
+        size_t cur;
+        size_t old;
+        const ConcurrentMap* map;
+
+        bool found() const { return cur != NPOS || old != NPOS; }
+        const Node* node() const {
+            const Table* t = cur != NPOS ? map->table_.load(std::memory_order_relaxed)
+                                         : map->old_.load(std::memory_order_relaxed);
+            return t->slots[cur != NPOS ? cur : old].load(std::memory_order_relaxed);
+        }
+    };
+
+    static uint8_t h2(uint64_t h) { return static_cast<uint8_t>(h >> 57); }
+
+    static uint64_t reverse_bits(uint64_t v) {
+        v = ((v >> 1) & 0x5555555555555555ull) | ((v & 0x5555555555555555ull) << 1);
+        v = ((v >> 2) & 0x3333333333333333ull) | ((v & 0x3333333333333333ull) << 2);
+        v = ((v >> 4) & 0x0f0f0f0f0f0f0f0full) | ((v & 0x0f0f0f0f0f0f0f0full) << 4);
+        v = ((v >> 8) & 0x00ff00ff00ff00ffull) | ((v & 0x00ff00ff00ff00ffull) << 8);
+        v = ((v >> 16) & 0x0000ffff0000ffffull) | ((v & 0x0000ffff0000ffffull) << 16);
+        return (v >> 32) | (v << 32);
+    }
+    static size_t max_load(size_t capacity) { return capacity - capacity / 8; }
+
+    static uint64_t load_ctrl(const Table& t, size_t g, std::memory_order order) {
+        return t.ctrl[g].load(order) ^ swiss::WordGroup::ALL_EMPTY;
+    }
+
+    static uint8_t ctrl_at(const Table& t, size_t i) {
+        return swiss::WordGroup::lane(load_ctrl(t, i / WIDTH, std::memory_order_relaxed), i % WIDTH);
+    }
+
+    // Only the writer stores control words, so read-modify-write is safe.
+    static void set_ctrl(Table& t, size_t i, uint8_t c) {
+        uint64_t word = swiss::WordGroup::with_lane(load_ctrl(t, i / WIDTH, std::memory_order_relaxed),
+                                                    i % WIDTH, c);
+        t.ctrl[i / WIDTH].store(word ^ swiss::WordGroup::ALL_EMPTY, std::memory_order_release);
+    }
+
+    template <typename Visit>
+    static size_t probe(const Table& t, std::string_view key, uint64_t h,
+                        std::memory_order order, Visit&& found) {
+        size_t mask = t.capacity / WIDTH - 1;
+        size_t g = static_cast<size_t>(h) & mask;
+        uint8_t tag = h2(h);
+        for (size_t step = 1;; ++step) {
+            swiss::WordGroup group(load_ctrl(t, g, order));
+            for (auto m = group.match(tag); m; m.clear_lowest()) {
+                size_t i = g * WIDTH + m.lowest();
+                const Node* n = t.slots[i].load(order);
+                if (n && n->hash == h && n->key.view() == key) {
+                    found(n);
+                    return i;
+                }
+            }
+            if (group.match_empty())
+                return NPOS;
+            g = (g + step) & mask;
+        }
+    }
+
+    static const Node* find_node(const Table& t, std::string_view key, uint64_t h,
+                                 std::memory_order order) {
+        const Node* node = nullptr;
+        probe(t, key, h, order, [&](const Node* n) { node = n; });
+        return node;
+    }
+
+    static size_t find_index(const Table& t, std::string_view key, uint64_t h) {
+        return probe(t, key, h, std::memory_order_relaxed, [](const Node*) {});
+    }
+
+    Slots locate(std::string_view key, uint64_t h) const {
+        const Table* t = table_.load(std::memory_order_relaxed);
+        const Table* old = old_.load(std::memory_order_relaxed);
+        return Slots{t ? find_index(*t, key, h) : NPOS, old ? find_index(*old, key, h) : NPOS, this};
+    }
+
+    // Whether n (from the new table) also sits in `old`, so a walk over
+    // both has already seen it there.
+    static bool in_old(const Table* old, const Node& n) {
+        return old && find_node(*old, n.key.view(), n.hash, std::memory_order_acquire);
+    }
+
+    // fn(const Node&) for the entries whose home group is `home`. An entry
+    // sits on its home group's probe sequence, no later than the first
+    // group with an EMPTY byte (where lookups stop).
+    template <typename F>
+    static void scan_group(const Table& t, uint64_t home, F&& fn) {
+        size_t mask = t.capacity / WIDTH - 1;
+        size_t g = static_cast<size_t>(home);
+        for (size_t step = 1; step <= mask + 1; ++step) {
+            swiss::WordGroup group(load_ctrl(t, g, std::memory_order_acquire));
+            for (size_t j = 0; j < WIDTH; ++j) {
+                const Node* n = t.slots[g * WIDTH + j].load(std::memory_order_acquire);
+                if (n && (static_cast<size_t>(n->hash) & mask) == home)
+                    fn(*n);
+            }
+            if (group.match_empty())
+                break;
+            g = (g + step) & mask;
+        }
+    }
+
+    // First EMPTY or DELETED slot on h's probe sequence.
+    static size_t find_free(const Table& t, uint64_t h) {
+        size_t mask = t.capacity / WIDTH - 1;
+        size_t g = static_cast<size_t>(h) & mask;
+        for (size_t step = 1;; ++step) {
+            swiss::WordGroup group(load_ctrl(t, g, std::memory_order_relaxed));
+            auto m = group.match_free();
+            if (m)
+                return g * WIDTH + m.lowest();
+            g = (g + step) & mask;
+        }
+    }
+
+    Node* make_node(uint64_t h, std::string_view key, V&& value, uint32_t access) const {
+        void* mem = arena_ ? arena_->allocate(sizeof(Node)) : nullptr;
+        Node* n = mem ? new (mem) Node{h, InlineKey(key, arena_), std::move(value)}
+                      : new Node{h, InlineKey(key, arena_), std::move(value)};
+        n->access.store(access, std::memory_order_relaxed);
+        n->in_slab = mem != nullptr;
+        return n;
+    }
+
+    static void destroy_node(Node* n) {
+        if (!n->in_slab) {
+            delete n;
+            return;
+        }
+        n->~Node();
+        SlabArena::free(n);
+    }
+
+    static size_t value_heap_bytes(const V& value) {
+        if constexpr (requires { value.heap_bytes(); })
+            return value.heap_bytes();
+        else
+            return 0;
+    }
+
+    // Single writer: a load and a store, not a read-modify-write.
+    static void store(std::atomic<size_t>& counter, size_t bytes) {
+        counter.store(bytes, std::memory_order_relaxed);
+    }
+    static void add(std::atomic<size_t>& counter, size_t bytes, int sign) {
+        size_t cur = counter.load(std::memory_order_relaxed);
+        store(counter, sign > 0 ? cur + bytes : cur - bytes);
+    }
+
+    // Count a node's out-of-line bytes in (sign 1) or out (-1).
+    void account(const Node& n, int sign) {
+        if (size_t k = n.key.heap_bytes())
+            add(key_bytes_, k, sign);
+        if (size_t v = value_heap_bytes(n.value))
+            add(value_bytes_, v, sign);
+    }
+
+    // The new table first, so a reader that misses there and then probes
+    // the old one sees the same node.
+    void replace(const Slots& at, Node* n) {
+        Node* old = nullptr;
+        if (at.cur != NPOS)
+            old = table_.load(std::memory_order_relaxed)->slots[at.cur].exchange(n, std::memory_order_acq_rel);
+        if (at.old != NPOS)
+            old = old_.load(std::memory_order_relaxed)->slots[at.old].exchange(n, std::memory_order_acq_rel);
+        account(*n, 1);
+        account(*old, -1);
+        reclaim(old, delete_node);
+    }
+
+    // Empty slot i, setting `node` to what it held. Returns whether the
+    // slot is EMPTY again (rather than a tombstone).
+    static bool unlink(Table& t, size_t i, Node*& node) {
+        node = t.slots[i].exchange(nullptr, std::memory_order_acq_rel);
+        // A group that still has an EMPTY byte ends every probe that reaches
+        // it, so no probe ever passed through it: the slot can be EMPTY again.
+        swiss::WordGroup group(load_ctrl(t, i / WIDTH, std::memory_order_relaxed));
+        bool empty = static_cast<bool>(group.match_empty());
+        set_ctrl(t, i, empty ? swiss::EMPTY : swiss::DELETED);
+        return empty;
+    }
+
+    // Start a rehash into a fresh table, reserving room in it for every
+    // entry, and return it. Readers keep probing a table until they next
+    // load table_, so the old one is retired only once it has drained.
+    Table* grow() {
+        if (Table* draining = old_.load(std::memory_order_relaxed))
+            rehash_step(draining->capacity);  // not reached at REHASH_SLOTS per write
+        Table* old = table_.load(std::memory_order_relaxed);
+        size_t capacity = MIN_CAPACITY;
+        if (old) {
+            // Out of room mostly because of tombstones: rehash at the same
+            // size to clear them; otherwise double.
+            capacity = size() <= max_load(old->capacity) / 2 ? old->capacity : old->capacity * 2;
+        }
+        Table* t = allocate(capacity);
+        growth_left_ = max_load(capacity) - size();
+        bool drain = old && size() > 0;
+        store(table_bytes_, (capacity + (drain ? old->capacity : 0)) * SLOT_BYTES);
+        if (drain)
+            old_.store(old, std::memory_order_release);
+        table_.store(t, std::memory_order_release);
+        if (old && !drain)
+            reclaim(old, free_table_arrays);
+        return t;
+    }
+
+    static size_t mapping_bytes(size_t capacity) { return capacity * (sizeof(Node*) + 1); }
+
+    static Table* allocate(size_t capacity) {
+        static_assert(sizeof(std::atomic<Node*>) == sizeof(Node*) &&
+                      sizeof(std::atomic<uint64_t>) == sizeof(uint64_t));
+        void* p = mmap(nullptr, mapping_bytes(capacity), PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED)
+            throw std::bad_alloc();
+        Table* t = new Table{capacity, nullptr, nullptr};
+        t->slots = static_cast<std::atomic<Node*>*>(p);
+        t->ctrl = reinterpret_cast<std::atomic<uint64_t>*>(t->slots + capacity);
+        return t;
+    }
+
+    static void free_table(Table* t) {
+        if (!t)
+            return;
+        for (size_t i = t->moved; i < t->capacity; ++i)
+            if (Node* n = t->slots[i].load(std::memory_order_relaxed))
+                destroy_node(n);
+        free_arrays(t);
+    }
+
+    static void free_arrays(Table* t) {
+        munmap(t->slots, mapping_bytes(t->capacity));
+        delete t;
+    }
+
+    static void delete_node(void* p) { destroy_node(static_cast<Node*>(p)); }
+    static void free_table_arrays(void* p) { free_arrays(static_cast<Table*>(p)); }
+    static void free_table_with_nodes(void* p) { free_table(static_cast<Table*>(p)); }
+
+    void reclaim(void* p, void (*deleter)(void*)) {
+        if (deferred_)
+            concurrency::retire(p, deleter);
+        else
+            deleter(p);
+    }
+
+    std::atomic<Table*> table_{nullptr};
+    std::atomic<Table*> old_{nullptr};  // draining into table_ mid-rehash
+    std::atomic<size_t> size_{0};
+    size_t growth_left_ = 0;   // inserts into EMPTY slots before the next rehash
+    std::atomic<size_t> table_bytes_{0};
+    std::atomic<size_t> key_bytes_{0};
+    std::atomic<size_t> value_bytes_{0};
+    bool deferred_ = true;
+    SlabArena* arena_ = nullptr;
+};
+
+} // namespace mini_redis
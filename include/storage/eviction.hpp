@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace mini_redis {
+
+// What a shard does when a write would take it over its memory budget.
+enum class EvictionPolicy : uint8_t {
+    NOEVICTION,    // refuse the write (OOM error)
+    ALLKEYS_LRU,   // evict the least recently used of a sample
+    ALLKEYS_LFU,   // evict the least frequently used of a sample
+    VOLATILE_TTL,  // evict the key with a TTL that expires soonest
+};
+
+inline bool parse_eviction_policy(std::string_view name, EvictionPolicy& out) {
+    if (name == "noeviction") out = EvictionPolicy::NOEVICTION;
+    else if (name == "allkeys-lru") out = EvictionPolicy::ALLKEYS_LRU;
+    else if (name == "allkeys-lfu") out = EvictionPolicy::ALLKEYS_LFU;
+    else if (name == "volatile-ttl") out = EvictionPolicy::VOLATILE_TTL;
+    else return false;
+    return true;
+}
+
+inline std::string_view eviction_policy_name(EvictionPolicy policy) {
+    switch (policy) {
+    case EvictionPolicy::ALLKEYS_LRU: return "allkeys-lru";
+    case EvictionPolicy::ALLKEYS_LFU: return "allkeys-lfu";
+    case EvictionPolicy::VOLATILE_TTL: return "volatile-ttl";
+    default: return "noeviction";
+    }
+}
+
+// Per-entry access stamps, 32 bits, kept in ConcurrentMap::Node::access.
+//
+// LRU: the clock in 16 ms ticks at the last access (wraps after ~2 years;
+// idle times are taken mod 2^32). A read stores at most once per tick.
+// LFU (as in Redis): minutes since the epoch, mod 2^24, in the high 24 bits
+// and a logarithmic access counter in the low 8. The counter starts at
+// LFU_INIT, grows with probability 1 / ((counter - LFU_INIT) * LFU_LOG_FACTOR + 1)
+// per access, and loses one per LFU_DECAY_MINUTES idle.
+namespace eviction {
+
+constexpr uint32_t LFU_INIT = 5;
+constexpr uint32_t LFU_LOG_FACTOR = 10;
+constexpr uint32_t LFU_DECAY_MINUTES = 1;
+
+inline uint32_t lru_clock(uint64_t now_ms) {
+    return static_cast<uint32_t>(now_ms >> 4);
+}
+
+inline uint32_t lfu_minutes(uint64_t now_ms) {
+    return static_cast<uint32_t>(now_ms / 60000) & 0xffffff;
+}
+
+inline uint32_t lfu_counter(uint32_t stamp, uint64_t now_ms) {
+    uint32_t idle = (lfu_minutes(now_ms) - (stamp >> 8)) & 0xffffff;
+    uint32_t decay = idle / LFU_DECAY_MINUTES;
+    uint32_t counter = stamp & 0xff;
+    return decay >= counter ? 0 : counter - decay;
+}
+
+// Cheap per-thread generator for the LFU coin flip and sample positions.
+inline uint64_t fast_rand() {
+    thread_local uint64_t state = reinterpret_cast<uintptr_t>(&state) | 1;
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+// Stamp for a newly written entry.
+inline uint32_t initial_stamp(EvictionPolicy policy, uint64_t now_ms) {
+    if (policy == EvictionPolicy::ALLKEYS_LFU)
+        return (lfu_minutes(now_ms) << 8) | LFU_INIT;
+    return lru_clock(now_ms);
+}
+
+// Stamp after a read; returns `stamp` itself when nothing changed, so
+// callers can skip the store and keep hot keys' cache lines shared.
+inline uint32_t touched_stamp(EvictionPolicy policy, uint32_t stamp, uint64_t now_ms) {
+    if (policy == EvictionPolicy::ALLKEYS_LRU)
+        return lru_clock(now_ms);
+    if (policy != EvictionPolicy::ALLKEYS_LFU)
+        return stamp;
+    uint32_t counter = lfu_counter(stamp, now_ms);
+    if (counter < 255) {
+        uint32_t base = counter > LFU_INIT ? counter - LFU_INIT : 0;
+        // P(increment) = 1 / (base * LFU_LOG_FACTOR + 1)
+        if (fast_rand() % (base * LFU_LOG_FACTOR + 1) == 0)
+            ++counter;
+    }
+    return (lfu_minutes(now_ms) << 8) | counter;
+}
+
+// Higher evicts first. volatile-ttl scores only keys with an expiry.
+inline uint64_t score(EvictionPolicy policy, uint32_t stamp, uint64_t expire_at, uint64_t now_ms) {
+    switch (policy) {
+    case EvictionPolicy::ALLKEYS_LRU:
+        return static_cast<uint32_t>(lru_clock(now_ms) - stamp);
+    case EvictionPolicy::ALLKEYS_LFU:
+        return 255 - lfu_counter(stamp, now_ms);
+    case EvictionPolicy::VOLATILE_TTL:
+        return UINT64_MAX - expire_at;
+    default:
+        return 0;
+    }
+}
+
+} // namespace eviction
+
+} // namespace mini_redis
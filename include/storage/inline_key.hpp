@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+
+#include "storage/slab.hpp"
+
+namespace mini_redis {
+
+// Owned key bytes in 24 bytes: keys up to 23 bytes live inline, longer ones
+// in one block from `arena` if given (else the heap). The last byte is the
+// inline length, or HEAP_TAG / SLAB_TAG when the first 16 bytes hold
+// {pointer, size}.
+class InlineKey {
+public:
+    static constexpr size_t INLINE_CAPACITY = 23;
+
+    InlineKey() { raw_[TAG] = 0; }
+
+    explicit InlineKey(std::string_view key, SlabArena* arena = nullptr) {
+        if (key.size() <= INLINE_CAPACITY) {
+            std::memcpy(raw_, key.data(), key.size());
+            raw_[TAG] = static_cast<unsigned char>(key.size());
+            return;
+        }
+        char* p = arena ? static_cast<char*>(arena->allocate(key.size())) : nullptr;
+        raw_[TAG] = p ? SLAB_TAG : HEAP_TAG;
+        if (!p)
+            p = new char[key.size()];
+        std::memcpy(p, key.data(), key.size());
+        size_t n = key.size();
+        std::memcpy(raw_, &p, sizeof(p));
+        std::memcpy(raw_ + sizeof(p), &n, sizeof(n));
+    }
+
+    ~InlineKey() {
+        if (raw_[TAG] == SLAB_TAG)
+            SlabArena::free(heap_ptr());
+        else if (raw_[TAG] == HEAP_TAG)
+            delete[] heap_ptr();
+    }
+
+    InlineKey(InlineKey&& other) noexcept {
+        std::memcpy(raw_, other.raw_, sizeof(raw_));
+        other.raw_[TAG] = 0;
+    }
+
+    InlineKey& operator=(InlineKey&& other) noexcept {
+        if (this != &other) {
+            this->~InlineKey();
+            std::memcpy(raw_, other.raw_, sizeof(raw_));
+            other.raw_[TAG] = 0;
+        }
+        return *this;
+    }
+
+    InlineKey(const InlineKey&) = delete;
+    InlineKey& operator=(const InlineKey&) = delete;
+
+    bool is_inline() const { return raw_[TAG] <= INLINE_CAPACITY; }
+    // The out-of-line block, if it came from a SlabArena.
+    const void* slab_block() const { return raw_[TAG] == SLAB_TAG ? heap_ptr() : nullptr; }
+
+    std::string_view view() const {
+        if (is_inline())
+            return {reinterpret_cast<const char*>(raw_), raw_[TAG]};
+        size_t n;
+        std::memcpy(&n, raw_ + sizeof(char*), sizeof(n));
+        return {heap_ptr(), n};
+    }
+
+    // Bytes allocated outside the object (0 for inline keys).
+    size_t heap_bytes() const { return is_inline() ? 0 : view().size(); }
+
+private:
+    static constexpr size_t TAG = 23;
+    static constexpr unsigned char HEAP_TAG = 0xFF;
+    static constexpr unsigned char SLAB_TAG = 0xFE;
+
+    char* heap_ptr() const {
+        char* p;
+        std::memcpy(&p, raw_, sizeof(p));
+        return p;
+    }
+
+    alignas(8) unsigned char raw_[24];
+};
+
+static_assert(sizeof(InlineKey) == 24);
+
+} // namespace mini_redis
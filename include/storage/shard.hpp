@@ -1,29 +1,159 @@
 #pragma once
 
-#include <unordered_map>
-#include <shared_mutex>
+#include <atomic>
+#include <functional>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 #include <cstdint>
+#include "concurrency/epoch.hpp"
+#include "common/glob.hpp"
+#include "storage/concurrent_map.hpp"
+#include "storage/eviction.hpp"
+#include "storage/slab.hpp"
+#include "storage/timing_wheel.hpp"
 #include "storage/value.hpp"
 
 namespace mini_redis {
 
+// Reads (get, exists, ttl, keys) take no lock: they pin an epoch and probe
+// the map while writers, serialized by the shard mutex, publish new entries
+// beside them. Expired entries are treated as missing by readers and removed
+// by expire_slice(), never on the read path.
+//
+// Every key with a TTL has an entry in the shard's timing wheel due no later
+// than its expiry. Refreshing a TTL to a later time adds nothing: when the
+// old entry falls due it finds the key still live and files it again under
+// the new deadline, so the wheel holds about one entry per expiring key.
+//
+// With a memory budget, each write that finds the shard over it first
+// evicts a few keys, each the best candidate of a small random sample
+// scored by the entries' access stamps (see eviction.hpp). There is no LRU
+// list: reads only refresh the stamp in the entry they found.
+//
+// Entries (nodes, long keys, value blobs) live in the shard's SlabArena.
+// Active defrag walks the table a slice at a time, rebuilding the entries
+// that sit in sparse slabs so those slabs empty and go back to the OS.
 class Shard {
 public:
-    using Map = std::unordered_map<std::string, Value>;
+    using Map = ConcurrentMap<Value>;
 
-    bool get(const std::string& key, Value& out, uint64_t now);
-    void set(const std::string& key, Value value);
-    bool del(const std::string& key);
-    bool exists(const std::string& key, uint64_t now);
-    bool set_expire(const std::string& key, uint64_t expire_at, uint64_t now);
-    int64_t ttl(const std::string& key, uint64_t now);
-    void keys(uint64_t now, std::vector<std::string>& out);
+    Shard();
+    ~Shard();
+
+    // `hash` is hash_key(key), computed once by the caller; `now` and expiry
+    // times are milliseconds on the now_ms() clock.
+    bool get(std::string_view key, uint64_t hash, Value& out, uint64_t now);
+    // false: over the memory budget and nothing could be evicted (the
+    // write is refused). Evicted keys are appended to `evicted` if given.
+    // The value is built under the shard's lock, in its arena.
+    bool set(std::string_view key, uint64_t hash, std::string_view value, uint64_t expire_at,
+             uint64_t now, std::vector<std::string>* evicted = nullptr);
+    bool del(std::string_view key, uint64_t hash, uint64_t now);
+    bool exists(std::string_view key, uint64_t hash, uint64_t now);
+    bool set_expire(std::string_view key, uint64_t hash, uint64_t expire_at, uint64_t now);
+    // Milliseconds left; -1 without an expiry, -2 if missing.
+    int64_t pttl(std::string_view key, uint64_t hash, uint64_t now);
+    // Appends the live keys that match `pattern`.
+    void keys(uint64_t now, const Glob& pattern, std::vector<std::string>& out);
+    // Resume a walk of the shard at `cursor` (0 = start; see
+    // ConcurrentMap::scan), appending live keys until about `count` are
+    // collected. Returns the next cursor, 0 when the walk is complete.
+    uint64_t scan(uint64_t cursor, size_t count, uint64_t now, std::vector<std::string>& out);
+
+    // Every live entry, copied under the shard's lock so the copy is the
+    // shard at one instant (an AOF rewrite). Values are shared, not copied.
+    using Snapshot = std::vector<std::pair<std::string, Value>>;
+    void snapshot(uint64_t now, Snapshot& out);
+
+    // Entries held, counting expired ones not yet reclaimed.
+    size_t size() const { return map_.size(); }
+    // `locked` runs before the shard's lock is released, so what it logs
+    // comes before any write the shard takes after the clear.
+    void clear(const std::function<void()>& locked = nullptr);
+
+    // 0 = unlimited. `samples` entries are compared per eviction. The
+    // budget covers the map (keys, values and table), not the wheel.
+    void set_memory_budget(size_t bytes, EvictionPolicy policy, size_t samples);
+    size_t memory_bytes() const { return map_.memory_bytes(); }
+
+    // Bytes held, by kind. Safe from any thread, in any mode: it reads
+    // counters the writer keeps, never the table itself.
+    struct MemoryUsage {
+        Map::MemoryUsage map;
+        size_t expires = 0;  // timing-wheel entries
+        size_t slab_reserved = 0;  // arena slabs in use
+        size_t slab_used = 0;      // live arena objects, rounded to size classes
+
+        size_t total() const { return map.total() + expires; }
+    };
+    MemoryUsage memory_usage() const;
+    // Bytes one live key accounts for (see ConcurrentMap::entry_bytes);
+    // false if it is missing.
+    bool key_memory(std::string_view key, uint64_t hash, uint64_t now, size_t& out);
+    uint64_t evicted_keys() const { return evicted_.load(std::memory_order_relaxed); }
+
+    // Erase up to `budget` keys whose deadline has passed. Skips the shard
+    // rather than wait if a writer holds it. Returns the keys expired;
+    // `backlog` is set when due entries remain.
+    size_t expire_slice(uint64_t now, size_t budget, bool& backlog);
+
+    // Move up to `slots` slots of a table mid-rehash (writes also do, a few
+    // per write), so an idle shard does not keep probing two tables. Skips
+    // a held shard. Returns whether a rehash is still under way.
+    bool rehash_slice(size_t slots);
+
+    // Active defrag: once the arena's free slab space passes
+    // `threshold_pct` percent of its live bytes, rebuild the entries in
+    // sparse slabs, looking at up to `budget` table slots per call. Skips
+    // the shard if a writer holds it. Returns the entries moved; `running`
+    // is set while a pass is under way.
+    size_t defrag_slice(size_t budget, size_t threshold_pct, bool& running);
+    uint64_t defrag_hits() const { return defrag_hits_.load(std::memory_order_relaxed); }
+    // Apply the arena frees other threads queued (deletes with no write
+    // after them would otherwise hold their slabs). Skips a held shard.
+    void reclaim();
+
+    // Shared-nothing mode: a single owning thread is the only accessor, so
+    // every operation skips the mutex and the epoch pin, and unlinked
+    // entries are freed at once.
+    void set_exclusive(bool exclusive);
 
 private:
+    concurrency::EpochGuard read_guard() const;
+    std::unique_lock<std::mutex> write_lock();
+
+    // Writers only: file a wheel entry for a key whose expiry becomes
+    // `expire_at` (was `old_expire_at`, 0 for none).
+    void schedule_expiry(std::string_view key, uint64_t hash, uint64_t old_expire_at,
+                         uint64_t expire_at, uint64_t now);
+
+    // Writers only: evict until under budget, at most a few keys per call.
+    // false if still over budget with nothing evictable.
+    bool make_room(uint64_t now, std::vector<std::string>* evicted);
+    bool evict_one(uint64_t now, std::vector<std::string>* evicted);
+    // Writers only: publish the wheel's size after changing it.
+    void note_wheel() {
+        wheel_bytes_.store(wheel_.memory_bytes(), std::memory_order_relaxed);
+    }
+
+    SlabArena* arena_;  // before map_: its nodes are freed into it
     Map map_;
-    mutable std::shared_mutex mutex_;
+    TimingWheel wheel_;
+    std::atomic<size_t> wheel_bytes_{0};
+    std::mutex mutex_;
+    bool exclusive_ = false;
+
+    size_t budget_ = 0;
+    size_t samples_ = 5;
+    EvictionPolicy policy_ = EvictionPolicy::NOEVICTION;
+    std::atomic<uint64_t> evicted_{0};
+
+    bool defragging_ = false;
+    size_t defrag_cursor_ = 0;  // next table slot of the pass
+    std::atomic<uint64_t> defrag_hits_{0};
 };
 
 } // namespace mini_redis
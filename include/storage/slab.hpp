@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace mini_redis {
+
+// Memory for one shard's entries: map nodes, long keys and value blobs.
+//
+// Objects up to MAX_OBJECT bytes are rounded up to a size class (16-byte
+// steps to 128, then four per doubling) and carved from SLAB_BYTES slabs
+// that each hold a single class. Slabs come from chunks mapped straight
+// from the OS; an emptied slab returns its pages at once and an emptied
+// chunk is unmapped, so churn cannot strand RSS in a fragmented heap.
+//
+// One thread allocates at a time (the shard's writer). Frees come from any
+// thread (nodes through the epoch collector, blobs from whichever reply
+// drops the last reference), so they are pushed onto a lock-free list and
+// applied by the owner on its next allocation or collect().
+//
+// Defrag: begin_defrag() withdraws from allocation the sparsest slabs whose
+// objects fit in the rest of their class; the owner then rebuilds whatever
+// evacuating() reports elsewhere, and the old slabs empty as the copies'
+// originals are freed.
+class SlabArena {
+public:
+    static constexpr size_t SLAB_BYTES = 64 * 1024;
+    static constexpr size_t MAX_OBJECT = 4096;
+
+    // Arenas are pooled, never freed: an object may outlive its shard (a
+    // reply still holding a blob), so a released arena stays valid for its
+    // frees and is handed to the next acquire().
+    static SlabArena* acquire();
+    void release();
+
+    // Owner: room for `bytes`, or nullptr if larger than MAX_OBJECT (or the
+    // OS refused a chunk); callers then use the heap.
+    void* allocate(size_t bytes);
+    // Any thread: return an object from allocate().
+    static void free(void* p);
+    // Owner: apply the frees other threads have queued.
+    void collect();
+
+    // Any thread; relaxed counters.
+    size_t reserved_bytes() const { return reserved_.load(std::memory_order_relaxed); }
+    size_t used_bytes() const { return used_.load(std::memory_order_relaxed); }
+    // Slab space not holding live objects exceeds both `ignore_bytes` and
+    // `threshold_pct` percent of the live bytes.
+    bool fragmented(size_t threshold_pct, size_t ignore_bytes) const;
+
+    // Owner. begin_defrag() returns false if no slab is worth emptying.
+    bool begin_defrag();
+    void end_defrag();
+    // Whether live object `p` (from allocate()) sits in a slab being emptied.
+    static bool evacuating(const void* p);
+
+    SlabArena(const SlabArena&) = delete;
+    SlabArena& operator=(const SlabArena&) = delete;
+
+private:
+    struct Slab;
+    struct Chunk {
+        char* base;
+        size_t live;  // slabs handed out
+    };
+    struct SizeClass {
+        Slab* partial = nullptr;  // slabs with free room, not evacuating
+        size_t slabs = 0;
+    };
+
+    SlabArena();
+
+    static Slab* slab_of(const void* p);
+    Slab* new_slab(size_t cls);
+    void release_slab(Slab* s);
+    void unmap_chunk(size_t index);
+    void free_local(void* p);
+    void link(Slab* s);
+    void unlink(Slab* s);
+
+    std::atomic<void*> remote_{nullptr};  // frees queued by any thread
+    std::vector<SizeClass> classes_;
+    std::vector<std::unique_ptr<Chunk>> chunks_;
+    std::vector<Slab*> empty_;       // mapped, pages returned, ready for reuse
+    std::vector<Slab*> evacuating_;
+    std::atomic<size_t> reserved_{0};  // SLAB_BYTES per slab handed out
+    std::atomic<size_t> used_{0};      // class sizes of live objects
+};
+
+} // namespace mini_redis
@@ -2,33 +2,146 @@
 
 #include <vector>
 #include <string>
+#include <string_view>
 #include <cstdint>
+#include <functional>
+#include <memory>
+#include "concurrency/thread_pool.hpp"
 #include "storage/shard.hpp"
+#include "storage/ttl_manager.hpp"
+#include "persistence/aof_rewriter.hpp"
 #include "persistence/aof_writer.hpp"
 
 namespace mini_redis {
 
 class StorageEngine {
 public:
+    // shard_count is rounded up to a power of two.
     explicit StorageEngine(size_t shard_count = 64);
 
-    bool get(const std::string& key, std::string& value);
-    void set(const std::string& key, std::string value);
-    void set_with_ttl(const std::string& key, std::string value, uint64_t ttl_seconds);
-    bool del(const std::string& key);
-    bool exists(const std::string& key);
-    bool expire(const std::string& key, uint64_t ttl_seconds);
-    int64_t ttl(const std::string& key);
-    std::vector<std::string> keys(const std::string& pattern);
-    void enable_aof(const std::string& filename, bool flush_each_write = true);
+    // Each key is hashed once (hash_key) and that hash picks the shard and
+    // probes the shard's table.
+    // `value` shares the stored bytes (see Value) rather than copying them.
+    // TTLs are in milliseconds; expiry times are Unix milliseconds on the
+    // now_ms() clock, and the AOF records the absolute time.
+    bool get(std::string_view key, Value& value);
+    // Writes return false when refused for lack of memory (see set_maxmemory).
+    bool set(std::string_view key, std::string_view value);
+    bool set_with_ttl(std::string_view key, std::string_view value, uint64_t ttl_ms);
+    bool set_with_expire_at(std::string_view key, std::string_view value, uint64_t expire_at_ms);
+    bool del(std::string_view key);
+    bool exists(std::string_view key);
+    bool expire(std::string_view key, uint64_t ttl_ms);
+    bool expire_at(std::string_view key, uint64_t expire_at_ms);
+    // Remaining time to live: -2 if the key is missing, -1 if it has no expiry.
+    int64_t ttl(std::string_view key);   // seconds, rounded
+    int64_t pttl(std::string_view key);  // milliseconds
+    // Keyspace-wide operations run shard by shard, spread over the thread
+    // pool when one is attached and the keyspace is large.
+    std::vector<std::string> keys(std::string_view pattern);
+    size_t dbsize();
+    void flush_all();
+    // Replay of a FLUSHSHARD record: clears the keys that would live in
+    // shard `slot` of `shards` (a power of two), whatever this engine's
+    // shard count.
+    void flush_slot(size_t slot, size_t shards);
+    // One bounded step of a keyspace walk (SCAN): appends about `count`
+    // keys matching `pattern` and returns the cursor to resume from, 0 once
+    // every shard has been walked. The cursor holds the shard in its top
+    // bits and that shard's table cursor below, so it survives resizes.
+    uint64_t scan(uint64_t cursor, size_t count, std::string_view pattern,
+                  std::vector<std::string>& out);
+    // Replays `filename`, then logs every write to it (see AOFWriter).
+    // False, with the AOF left off, if the file is damaged (see AOFReader)
+    // or cannot be opened for writing.
+    bool enable_aof(const std::string& filename, AofFsync policy = AofFsync::EVERYSEC);
+    // Null while the AOF is off.
+    AOFWriter* aof() { return aof_writer_.get(); }
+    AOFRewriter* aof_rewriter() { return aof_rewriter_.get(); }
+    // BGREWRITEAOF (see AOFRewriter); false if the AOF is off or a rewrite
+    // is already under way.
+    bool rewrite_aof() { return aof_rewriter_ && aof_rewriter_->start(); }
+    // Shard holding `key`; writes to different shards never contend (AOF
+    // replay applies them in parallel).
+    size_t shard_of(std::string_view key) const { return shard_index(hash_key(key)); }
+
+    // Memory limit (0 = none), split evenly across the shards; each shard
+    // keeps to its share by evicting under `policy` (see Shard).
+    void set_maxmemory(size_t bytes, EvictionPolicy policy, size_t samples);
+    size_t maxmemory() const { return maxmemory_; }
+    EvictionPolicy eviction_policy() const { return eviction_policy_; }
+    uint64_t evicted_keys() const;
+
+    // Memory accounting (INFO memory, MEMORY STATS): safe from any thread in
+    // either mode, as they read per-shard counters rather than the tables.
+    size_t shard_count() const { return shards_.size(); }
+    size_t shard_keys(size_t i) const { return shards_[i].size(); }
+    Shard::MemoryUsage shard_memory(size_t i) const { return shards_[i].memory_usage(); }
+    // MEMORY USAGE: bytes attributable to `key`; false if it is missing.
+    bool key_memory(std::string_view key, size_t& out);
+
+    // Background expiry and its stats (see TtlManager).
+    TtlManager& expiry() { return ttl_manager_; }
+    // Expire up to `budget` due keys in each shard the calling thread may
+    // touch (all of them in shared mode). Sets `backlog` if any are left.
+    size_t active_expire(size_t budget, bool& backlog);
+    // Advance shard tables mid-rehash by up to `slots` slots each (see
+    // Shard::rehash_slice). Sets `backlog` if one is still under way.
+    void active_rehash(size_t slots, bool& backlog);
+
+    // Active defrag (see Shard::defrag_slice), off until enabled. Each call
+    // looks at up to `budget` table slots in each shard the caller may
+    // touch; `running` is set while a pass is under way. Disabled, it only
+    // applies queued frees (Shard::reclaim).
+    void set_active_defrag(bool enabled, size_t threshold_pct) {
+        defrag_enabled_ = enabled;
+        defrag_threshold_pct_ = threshold_pct;
+    }
+    bool active_defrag_enabled() const { return defrag_enabled_; }
+    size_t active_defrag(size_t budget, bool& running);
+    uint64_t defrag_hits() const;
+
+    // AOF rewrite: starts an automatic one when due, and snapshots one
+    // shard the caller may touch for a rewrite under way. Sets `backlog`
+    // while shards are left to snapshot.
+    void active_aof_rewrite(bool& backlog);
+
+    // Shared-nothing mode: shard i belongs to core i % cores and is touched
+    // only by that core's thread, lock-free. Callers route each key to
+    // owner_core(key) (a SCAN cursor to scan_owner_core(cursor)) and call
+    // bind_core() once on every core thread; keys(), dbsize() and
+    // flush_all() then cover just the calling core's shards.
+    void partition(size_t cores);
+    // Workers for keyspace-wide operations in shared mode; may be null.
+    void set_thread_pool(concurrency::ThreadPool* pool) { pool_ = pool; }
+    size_t owner_core(std::string_view key) const;
+    size_t scan_owner_core(uint64_t cursor) const;
+    static void bind_core(size_t core);
 
 private:
     std::vector<Shard> shards_;
+    size_t shard_mask_;
+    std::vector<size_t> shard_owner_;  // core owning each shard (mesh mode)
 
-    Shard& shard_for(const std::string& key);
-    uint64_t now_seconds() const;
+    // Bits 32 and up: the shard's table uses the low bits and the top 7.
+    size_t shard_index(uint64_t hash) const { return (hash >> 32) & shard_mask_; }
+    bool owns_shard(size_t i) const;
+    // fn(i) for every shard the calling thread may touch.
+    void for_each_shard(const std::function<void(size_t)>& fn);
 
     std::unique_ptr<AOFWriter> aof_writer_;
+    std::unique_ptr<AOFRewriter> aof_rewriter_;  // after aof_writer_: stops first
+    size_t cores_ = 0;  // 0 = shared mode (all threads, per-shard locks)
+    concurrency::ThreadPool* pool_ = nullptr;
+
+    size_t maxmemory_ = 0;
+    EvictionPolicy eviction_policy_ = EvictionPolicy::NOEVICTION;
+    bool defrag_enabled_ = false;
+    size_t defrag_threshold_pct_ = 10;
+
+    bool store(std::string_view key, std::string_view value, uint64_t expire_at);
+
+    TtlManager ttl_manager_{*this};  // last: its thread stops before the shards go
 };
 
 } // namespace mini_redis
@@ -0,0 +1,368 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string_view>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MINI_REDIS_SWISS_SSE2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define MINI_REDIS_SWISS_NEON 1
+#endif
+
+#include "common/hash.hpp"
+#include "storage/inline_key.hpp"
+
+namespace mini_redis {
+
+namespace swiss {
+
+// Control byte per slot: 0x00-0x7F = full (7 hash bits), or one of these.
+constexpr uint8_t EMPTY = 0x80;
+constexpr uint8_t DELETED = 0xFE;
+
+// Set lanes of a group match; SHIFT converts a bit index to a lane index.
+template <typename T, int SHIFT>
+class BitMask {
+public:
+    explicit BitMask(T mask) : mask_(mask) {}
+    explicit operator bool() const { return mask_ != 0; }
+    size_t lowest() const { return static_cast<size_t>(std::countr_zero(mask_)) >> SHIFT; }
+    void clear_lowest() { mask_ &= mask_ - 1; }
+
+private:
+    T mask_;
+};
+
+// 8 control bytes held in one word, lane i in bits [8i, 8i + 8) (SWAR). Used
+// directly where the word is loaded atomically (ConcurrentMap), and as the
+// portable Group. match() may report a false positive next to a real one;
+// callers compare keys anyway.
+struct WordGroup {
+    static constexpr size_t WIDTH = 8;
+    using Mask = BitMask<uint64_t, 3>;
+    static constexpr uint64_t LSBS = 0x0101010101010101ull;
+    static constexpr uint64_t MSBS = 0x8080808080808080ull;
+    static constexpr uint64_t ALL_EMPTY = LSBS * EMPTY;
+
+    explicit WordGroup(uint64_t ctrl) : ctrl_(ctrl) {}
+
+    Mask match(uint8_t h2) const {
+        uint64_t x = ctrl_ ^ (LSBS * h2);
+        return Mask((x - LSBS) & ~x & MSBS);
+    }
+    // Top bit set and bit 1 clear: EMPTY (0x80) but not DELETED (0xFE).
+    Mask match_empty() const { return Mask(ctrl_ & ~(ctrl_ << 6) & MSBS); }
+    Mask match_free() const { return Mask(ctrl_ & MSBS); }
+
+    static uint8_t lane(uint64_t ctrl, size_t i) { return static_cast<uint8_t>(ctrl >> (8 * i)); }
+    static uint64_t with_lane(uint64_t ctrl, size_t i, uint8_t c) {
+        return (ctrl & ~(uint64_t{0xFF} << (8 * i))) | (uint64_t{c} << (8 * i));
+    }
+
+private:
+    uint64_t ctrl_;
+};
+
+#if defined(MINI_REDIS_SWISS_SSE2)
+
+// 16 control bytes compared in one SSE2 instruction.
+struct Group {
+    static constexpr size_t WIDTH = 16;
+    using Mask = BitMask<uint32_t, 0>;
+
+    explicit Group(const uint8_t* ctrl)
+        : ctrl_(_mm_load_si128(reinterpret_cast<const __m128i*>(ctrl))) {}
+
+    Mask match(uint8_t h2) const {
+        return Mask(static_cast<uint32_t>(
+            _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(static_cast<char>(h2)), ctrl_))));
+    }
+    Mask match_empty() const { return match(EMPTY); }
+    // EMPTY and DELETED are the only control bytes with the top bit set.
+    Mask match_free() const { return Mask(static_cast<uint32_t>(_mm_movemask_epi8(ctrl_))); }
+
+private:
+    __m128i ctrl_;
+};
+
+#elif defined(MINI_REDIS_SWISS_NEON)
+
+// 8 control bytes per NEON compare; one result byte per lane.
+struct Group {
+    static constexpr size_t WIDTH = 8;
+    using Mask = BitMask<uint64_t, 3>;
+    static constexpr uint64_t MSBS = 0x8080808080808080ull;
+
+    explicit Group(const uint8_t* ctrl) : ctrl_(vld1_u8(ctrl)) {}
+
+    Mask match(uint8_t h2) const {
+        uint8x8_t eq = vceq_u8(ctrl_, vdup_n_u8(h2));
+        return Mask(vget_lane_u64(vreinterpret_u64_u8(eq), 0) & MSBS);
+    }
+    Mask match_empty() const { return match(EMPTY); }
+    Mask match_free() const {
+        uint8x8_t neg = vcltz_s8(vreinterpret_s8_u8(ctrl_));
+        return Mask(vget_lane_u64(vreinterpret_u64_u8(neg), 0) & MSBS);
+    }
+
+private:
+    uint8x8_t ctrl_;
+};
+
+#else
+
+// Portable fallback: the SWAR word group over 8 control bytes in memory.
+struct Group : WordGroup {
+    explicit Group(const uint8_t* ctrl) : WordGroup(load(ctrl)) {}
+
+private:
+    static uint64_t load(const uint8_t* ctrl) {
+        uint64_t w = 0;
+        for (size_t i = 0; i < WIDTH; ++i)
+            w |= uint64_t{ctrl[i]} << (8 * i);
+        return w;
+    }
+};
+
+#endif
+
+// The shared key hash (common/hash.hpp), so a hash computed once by the
+// storage engine can be handed straight to the table.
+struct KeyHash {
+    uint64_t operator()(std::string_view key) const { return hash_key(key); }
+};
+
+} // namespace swiss
+
+// Open-addressing hash map from string keys to V, Swiss-table style. A
+// control byte per slot holds 7 bits of the key's hash; a lookup compares a
+// whole group of them at once and touches a slot only on a likely match.
+// Keys are stored inline (InlineKey) next to their value, so a hit costs
+// the control group plus one slot rather than a chain of node pointers.
+//
+// Probing visits whole groups (group-aligned, triangular sequence over the
+// groups) and stops at the first group with an EMPTY byte. The table grows
+// at 7/8 load. Not thread-safe.
+template <typename V, typename Hash = swiss::KeyHash>
+class SwissMap {
+public:
+    struct Slot {
+        InlineKey key;
+        V value;
+    };
+
+    SwissMap() = default;
+    ~SwissMap() { destroy(); }
+
+    SwissMap(const SwissMap&) = delete;
+    SwissMap& operator=(const SwissMap&) = delete;
+
+    SwissMap(SwissMap&& other) noexcept { steal(other); }
+    SwissMap& operator=(SwissMap&& other) noexcept {
+        if (this != &other) {
+            destroy();
+            steal(other);
+        }
+        return *this;
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    size_t capacity() const { return capacity_; }
+
+    V* find(std::string_view key) {
+        size_t i = find_index(key, Hash{}(key));
+        return i == NPOS ? nullptr : &slots_[i].value;
+    }
+    const V* find(std::string_view key) const {
+        return const_cast<SwissMap*>(this)->find(key);
+    }
+
+    // Insert, or overwrite the existing value. Returns true if key was new.
+    bool insert_or_assign(std::string_view key, V value) {
+        uint64_t h = Hash{}(key);
+        size_t i = find_index(key, h);
+        if (i != NPOS) {
+            slots_[i].value = std::move(value);
+            return false;
+        }
+        if (growth_left_ == 0)
+            grow();
+        i = find_free(h);
+        if (ctrl_[i] == swiss::EMPTY)
+            --growth_left_;
+        set_ctrl(i, h2(h));
+        new (&slots_[i]) Slot{InlineKey(key), std::move(value)};
+        key_heap_bytes_ += slots_[i].key.heap_bytes();
+        ++size_;
+        return true;
+    }
+
+    bool erase(std::string_view key) {
+        size_t i = find_index(key, Hash{}(key));
+        if (i == NPOS)
+            return false;
+        erase_at(i);
+        return true;
+    }
+
+    void clear() { destroy(); }
+
+    // fn(std::string_view key, V& value) for every entry, in table order.
+    template <typename F>
+    void for_each(F&& fn) {
+        for (size_t i = 0; i < capacity_; ++i)
+            if (is_full(ctrl_[i]))
+                fn(slots_[i].key.view(), slots_[i].value);
+    }
+    template <typename F>
+    void for_each(F&& fn) const {
+        for (size_t i = 0; i < capacity_; ++i)
+            if (is_full(ctrl_[i]))
+                fn(slots_[i].key.view(), static_cast<const V&>(slots_[i].value));
+    }
+
+    // Table arrays plus out-of-line key bytes; excludes what V owns.
+    size_t memory_bytes() const {
+        return capacity_ * (1 + sizeof(Slot)) + key_heap_bytes_;
+    }
+
+private:
+    static constexpr size_t NPOS = static_cast<size_t>(-1);
+    static constexpr size_t WIDTH = swiss::Group::WIDTH;
+    static constexpr size_t MIN_CAPACITY = 2 * WIDTH;
+
+    static bool is_full(uint8_t c) { return (c & 0x80) == 0; }
+    static uint8_t h2(uint64_t h) { return static_cast<uint8_t>(h >> 57); }
+    static size_t max_load(size_t capacity) { return capacity - capacity / 8; }
+
+    size_t find_index(std::string_view key, uint64_t h) const {
+        if (capacity_ == 0)
+            return NPOS;
+        size_t mask = capacity_ / WIDTH - 1;
+        size_t g = static_cast<size_t>(h) & mask;
+        uint8_t tag = h2(h);
+        for (size_t step = 1;; ++step) {
+            const uint8_t* ctrl = ctrl_ + g * WIDTH;
+            swiss::Group group(ctrl);
+            for (auto m = group.match(tag); m; m.clear_lowest()) {
+                size_t i = g * WIDTH + m.lowest();
+                if (slots_[i].key.view() == key)
+                    return i;
+            }
+            if (group.match_empty())
+                return NPOS;
+            g = (g + step) & mask;
+        }
+    }
+
+    // First EMPTY or DELETED slot on h's probe sequence.
+    size_t find_free(uint64_t h) const {
+        size_t mask = capacity_ / WIDTH - 1;
+        size_t g = static_cast<size_t>(h) & mask;
+        for (size_t step = 1;; ++step) {
+            swiss::Group group(ctrl_ + g * WIDTH);
+            auto m = group.match_free();
+            if (m)
+                return g * WIDTH + m.lowest();
+            g = (g + step) & mask;
+        }
+    }
+
+    void set_ctrl(size_t i, uint8_t c) { ctrl_[i] = c; }
+
+    void erase_at(size_t i) {
+        key_heap_bytes_ -= slots_[i].key.heap_bytes();
+        slots_[i].~Slot();
+        --size_;
+        // A group that still has an EMPTY byte ends every probe that reaches
+        // it, so no probe ever passed through it: the slot can be EMPTY again.
+        swiss::Group group(ctrl_ + (i / WIDTH) * WIDTH);
+        if (group.match_empty()) {
+            set_ctrl(i, swiss::EMPTY);
+            ++growth_left_;
+        } else {
+            set_ctrl(i, swiss::DELETED);
+        }
+    }
+
+    void grow() {
+        // Out of room mostly because of tombstones: rehash at the same size
+        // to clear them; otherwise double.
+        if (capacity_ == 0)
+            rehash(MIN_CAPACITY);
+        else if (size_ <= max_load(capacity_) / 2)
+            rehash(capacity_);
+        else
+            rehash(capacity_ * 2);
+    }
+
+    void rehash(size_t new_capacity) {
+        uint8_t* old_ctrl = ctrl_;
+        Slot* old_slots = slots_;
+        size_t old_capacity = capacity_;
+
+        allocate(new_capacity);
+        for (size_t i = 0; i < old_capacity; ++i) {
+            if (!is_full(old_ctrl[i]))
+                continue;
+            uint64_t h = Hash{}(old_slots[i].key.view());
+            size_t j = find_free(h);
+            set_ctrl(j, h2(h));
+            new (&slots_[j]) Slot(std::move(old_slots[i]));
+            old_slots[i].~Slot();
+        }
+        growth_left_ = max_load(capacity_) - size_;
+        release(old_ctrl, old_slots);
+    }
+
+    void allocate(size_t capacity) {
+        capacity_ = capacity;
+        ctrl_ = static_cast<uint8_t*>(::operator new(capacity, std::align_val_t{16}));
+        std::memset(ctrl_, swiss::EMPTY, capacity);
+        slots_ = static_cast<Slot*>(::operator new(capacity * sizeof(Slot),
+                                                   std::align_val_t{alignof(Slot)}));
+    }
+
+    static void release(uint8_t* ctrl, Slot* slots) {
+        if (ctrl)
+            ::operator delete(ctrl, std::align_val_t{16});
+        if (slots)
+            ::operator delete(slots, std::align_val_t{alignof(Slot)});
+    }
+
+    void destroy() {
+        for (size_t i = 0; i < capacity_; ++i)
+            if (is_full(ctrl_[i]))
+                slots_[i].~Slot();
+        release(ctrl_, slots_);
+        ctrl_ = nullptr;
+        slots_ = nullptr;
+        capacity_ = size_ = growth_left_ = key_heap_bytes_ = 0;
+    }
+
+    void steal(SwissMap& other) {
+        ctrl_ = std::exchange(other.ctrl_, nullptr);
+        slots_ = std::exchange(other.slots_, nullptr);
+        capacity_ = std::exchange(other.capacity_, 0);
+        size_ = std::exchange(other.size_, 0);
+        growth_left_ = std::exchange(other.growth_left_, 0);
+        key_heap_bytes_ = std::exchange(other.key_heap_bytes_, 0);
+    }
+
+    uint8_t* ctrl_ = nullptr;
+    Slot* slots_ = nullptr;
+    size_t capacity_ = 0;      // slots; a power of two, multiple of WIDTH
+    size_t size_ = 0;
+    size_t growth_left_ = 0;   // inserts into EMPTY slots before the next rehash
+    size_t key_heap_bytes_ = 0;
+};
+
+} // namespace mini_redis
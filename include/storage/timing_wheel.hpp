@@ -0,0 +1,65 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mini_redis {
+
+// Hierarchical timing wheel of key deadlines (Varghese & Lauck). LEVELS
+// wheels of 64 slots; a level-L slot spans 64^L ticks. An entry is filed on
+// the lowest level whose range covers its deadline and moves down a level
+// each time the wheel reaches its slot, so scheduling is O(1) and each entry
+// is touched at most LEVELS times before it falls due. Deadlines past the
+// top level wait in an overflow list.
+//
+// advance() skips straight to the next occupied slot (per-level occupancy
+// bitmaps), so idle stretches cost nothing. Entries that fall due collect in
+// a due list for the caller to drain at its own pace. Not thread-safe.
+class TimingWheel {
+public:
+    struct Entry {
+        std::string key;
+        uint64_t hash;
+        uint64_t deadline;
+    };
+
+    // Due at `deadline`; `now` anchors an empty wheel.
+    void schedule(std::string_view key, uint64_t hash, uint64_t deadline, uint64_t now);
+    void schedule(Entry&& entry);
+
+    // Move every entry with deadline <= now onto the due list.
+    void advance(uint64_t now);
+
+    // Take one due entry; false when none is left.
+    bool pop_due(Entry& out);
+    bool has_due() const { return !due_.empty(); }
+
+    void clear();
+
+    // Entries scheduled or due.
+    size_t size() const { return count_ + due_.size(); }
+    // Approximate: the entries themselves, not vector slack or long keys.
+    size_t memory_bytes() const { return size() * sizeof(Entry); }
+
+private:
+    static constexpr size_t LEVELS = 5;
+    static constexpr unsigned BITS = 6;  // 64 slots per level
+    static constexpr size_t SLOTS = size_t{1} << BITS;
+
+    void place(Entry&& entry);
+    void cascade(size_t level);
+    uint64_t next_event() const;
+
+    std::array<std::array<std::vector<Entry>, SLOTS>, LEVELS> slots_;
+    std::array<uint64_t, LEVELS> occupied_{};  // bit s: slots_[level][s] non-empty
+    std::vector<Entry> overflow_;
+    std::vector<Entry> due_;
+    uint64_t current_ = 0;  // every filed deadline is later than this
+    size_t count_ = 0;      // entries in slots_ and overflow_
+};
+
+} // namespace mini_redis
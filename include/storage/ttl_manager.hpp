@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+namespace mini_redis {
+
+class StorageEngine;
+
+// Active expiry. Keys with a TTL sit in their shard's TimingWheel; a cycle
+// expires at most a small budget of keys per shard and skips any shard a
+// writer holds, so cleanup runs in short slices beside the command path.
+// While shards are left with due keys, cycles repeat quickly until the
+// backlog drains.
+//
+// Each cycle also moves a slice of any shard table that is mid-rehash, runs
+// a slice of active defrag, when enabled, and snapshots a shard for an AOF
+// rewrite under way.
+//
+// Shared mode: start() runs cycles on a background thread. Mesh mode: each
+// core's reactor calls run_cycle() from its own loop, covering the shards
+// that core owns.
+class TtlManager {
+public:
+    explicit TtlManager(StorageEngine& storage);
+    ~TtlManager();
+
+    TtlManager(const TtlManager&) = delete;
+    TtlManager& operator=(const TtlManager&) = delete;
+
+    void start();
+    void stop();
+
+    // One cycle over the calling thread's shards. Returns milliseconds until
+    // the next cycle is due.
+    int run_cycle();
+
+    uint64_t expired_keys() const { return expired_.load(std::memory_order_relaxed); }
+    // Keys expired per second over the last sampling window (about 1s).
+    uint64_t expired_per_sec() const { return rate_.load(std::memory_order_relaxed); }
+
+private:
+    void record(size_t expired);
+
+    StorageEngine& storage_;
+
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+
+    std::atomic<uint64_t> expired_{0};
+    std::atomic<uint64_t> rate_{0};
+    std::mutex sample_mutex_;
+    uint64_t sample_start_ms_ = 0;
+    uint64_t sample_expired_ = 0;
+};
+
+} // namespace mini_redis
@@ -1,22 +1,181 @@
 #pragma once
 
-#include <string>
+#include <charconv>
 #include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include "storage/blob.hpp"
 
 namespace mini_redis {
 
-struct Value {
-    std::string data;
-    uint64_t expire_at; // 0 = never expires
+// A string value in 16 bytes plus its expiry, in one of three encodings:
+//   INT       canonical decimal integers, kept as an int64_t
+//   EMBEDDED  up to EMBED_CAPACITY bytes, stored inside the Value (and so
+//             inside the map slot, next to the key)
+//   BLOB      anything longer, as a shared immutable Blob; copying the Value
+//             (e.g. for a GET reply) only bumps a reference count
+class Value {
+public:
+    enum class Encoding : uint8_t { EMBEDDED, INT, BLOB };
+
+    static constexpr size_t EMBED_CAPACITY = 14;
+    static constexpr size_t INT_CHARS = 20;  // "-9223372036854775808"
+
+    uint64_t expire_at = 0;  // Unix ms (now_ms()); 0 = never expires
+
+    Value() = default;
+
+    // A BLOB is allocated from `arena` when one is given (see Blob).
+    explicit Value(std::string_view data, uint64_t exp = 0, SlabArena* arena = nullptr)
+        : expire_at(exp) {
+        int64_t n;
+        if (parse_canonical_int(data, n)) {
+            std::memcpy(payload_, &n, sizeof(n));
+            encoding_ = Encoding::INT;
+        } else if (data.size() <= EMBED_CAPACITY) {
+            std::memcpy(payload_, data.data(), data.size());
+            size_ = static_cast<uint8_t>(data.size());
+        } else {
+            Blob* blob = Blob::create(data, arena);
+            std::memcpy(payload_, &blob, sizeof(blob));
+            encoding_ = Encoding::BLOB;
+        }
+    }
+
+    Value(const Value& other) { copy_from(other); }
+
+    Value(Value&& other) noexcept {
+        copy_raw(other);
+        other.encoding_ = Encoding::EMBEDDED;
+    }
+
+    Value& operator=(const Value& other) {
+        if (this != &other) {
+            reset();
+            copy_from(other);
+        }
+        return *this;
+    }
 
-    Value() : expire_at(0) {}
+    Value& operator=(Value&& other) noexcept {
+        if (this != &other) {
+            reset();
+            copy_raw(other);
+            other.encoding_ = Encoding::EMBEDDED;
+        }
+        return *this;
+    }
 
-    Value(std::string d, uint64_t exp = 0)
-        : data(std::move(d)), expire_at(exp) {}
+    ~Value() { reset(); }
 
     bool is_expired(uint64_t now) const {
         return expire_at != 0 && expire_at <= now;
     }
+
+    Encoding encoding() const { return encoding_; }
+
+    // The value's bytes. INT values are rendered into `scratch`; the view
+    // is valid while both this Value and scratch are.
+    std::string_view bytes(char (&scratch)[INT_CHARS]) const {
+        switch (encoding_) {
+        case Encoding::INT: {
+            char* end = std::to_chars(scratch, scratch + INT_CHARS, as_int()).ptr;
+            return {scratch, static_cast<size_t>(end - scratch)};
+        }
+        case Encoding::BLOB:
+            return blob()->view();
+        default:
+            return {payload_, size_};
+        }
+    }
+
+    std::string str() const {
+        char scratch[INT_CHARS];
+        return std::string(bytes(scratch));
+    }
+
+    // Another reference to a BLOB value's bytes; empty for other encodings.
+    BlobRef share() const {
+        if (encoding_ != Encoding::BLOB)
+            return {};
+        blob()->retain();
+        return BlobRef::adopt(blob());
+    }
+
+    // A BLOB's block, if it came from a SlabArena.
+    const void* slab_block() const {
+        return encoding_ == Encoding::BLOB && blob()->in_slab() ? blob() : nullptr;
+    }
+
+    // The same value with its bytes copied into `arena` (defrag).
+    Value relocated(SlabArena* arena) const {
+        if (encoding_ != Encoding::BLOB)
+            return *this;
+        Value v;
+        Blob* b = Blob::create(blob()->view(), arena);
+        std::memcpy(v.payload_, &b, sizeof(b));
+        v.encoding_ = Encoding::BLOB;
+        v.expire_at = expire_at;
+        return v;
+    }
+
+    // Heap bytes owned beyond sizeof(Value) (a shared blob counts in full).
+    size_t heap_bytes() const {
+        return encoding_ == Encoding::BLOB ? Blob::allocation_size(blob()->size()) : 0;
+    }
+
+private:
+    // Only the exact text an int64_t prints as (no sign, zero padding or
+    // "-0"), so GET returns what SET stored.
+    static bool parse_canonical_int(std::string_view s, int64_t& out) {
+        if (s.empty() || s.size() > INT_CHARS)
+            return false;
+        if (s[0] == '0' && s.size() > 1)
+            return false;
+        if (s[0] == '-' && (s.size() == 1 || s[1] == '0'))
+            return false;
+        auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), out);
+        return ec == std::errc() && end == s.data() + s.size();
+    }
+
+    int64_t as_int() const {
+        int64_t n;
+        std::memcpy(&n, payload_, sizeof(n));
+        return n;
+    }
+
+    Blob* blob() const {
+        Blob* b;
+        std::memcpy(&b, payload_, sizeof(b));
+        return b;
+    }
+
+    void copy_raw(const Value& other) {
+        expire_at = other.expire_at;
+        std::memcpy(payload_, other.payload_, sizeof(payload_));
+        size_ = other.size_;
+        encoding_ = other.encoding_;
+    }
+
+    void copy_from(const Value& other) {
+        copy_raw(other);
+        if (encoding_ == Encoding::BLOB)
+            blob()->retain();
+    }
+
+    void reset() {
+        if (encoding_ == Encoding::BLOB)
+            blob()->release();
+        encoding_ = Encoding::EMBEDDED;
+        size_ = 0;
+    }
+
+    alignas(8) char payload_[EMBED_CAPACITY] = {};
+    uint8_t size_ = 0;  // EMBEDDED length
+    Encoding encoding_ = Encoding::EMBEDDED;
 };
 
+static_assert(sizeof(Value) == 24);
+
 } // namespace mini_redis
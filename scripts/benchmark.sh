@@ -26,4 +26,4 @@ fi
 [ -z "$elapsed" ] || [ "$elapsed" = "0" ] && elapsed=1
 rps=$(python3 -c "print(int($N / $elapsed))" 2>/dev/null || echo "$N")
 echo "Done: $N requests in ${elapsed}s -> ~$rps req/s"
-echo "Tip: set aof_fsync=no in config/server.conf for higher throughput."
+echo "Tip: set appendfsync=no in config/server.conf for higher throughput."
@@ -10,12 +10,13 @@ if command -v cmake &>/dev/null; then
 else
   g++ -std=c++20 -pthread \
     src/main.cpp \
-    src/concurrency/rw_lock.cpp src/concurrency/thread_pool.cpp \
+    src/common/config.cpp src/common/crc32c.cpp src/common/glob.cpp src/common/memory_stats.cpp src/common/time.cpp \
+    src/concurrency/epoch.cpp src/concurrency/rw_lock.cpp src/concurrency/thread_pool.cpp \
     src/metrics/exporter.cpp src/metrics/metrics.cpp \
-    src/net/connection.cpp src/net/event_loop.cpp src/net/server.cpp src/net/socket.cpp \
-    src/persistence/aof_reader.cpp src/persistence/aof_writer.cpp src/persistence/persistence.cpp \
-    src/protocol/command.cpp src/protocol/parser.cpp src/protocol/response.cpp \
-    src/storage/shard.cpp src/storage/storage_engine.cpp src/storage/ttl_manager.cpp \
+    src/net/buffer.cpp src/net/connection.cpp src/net/event_loop.cpp src/net/reactor.cpp src/net/server.cpp src/net/socket.cpp src/net/uring.cpp \
+    src/persistence/aof_reader.cpp src/persistence/aof_rewriter.cpp src/persistence/aof_writer.cpp src/persistence/persistence.cpp \
+    src/protocol/command.cpp src/protocol/executor.cpp src/protocol/parser.cpp src/protocol/response.cpp \
+    src/storage/shard.cpp src/storage/slab.cpp src/storage/storage_engine.cpp src/storage/timing_wheel.cpp src/storage/ttl_manager.cpp \
     -I include -o mini_redis
   echo "Built: ./mini_redis"
 fi
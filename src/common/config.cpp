@@ -16,6 +16,27 @@ std::string trim(const std::string& s) {
     return s.substr(start, end == std::string::npos ? std::string::npos : end - start + 1);
 }
 
+// "100000", "64kb", "100mb", "2gb" (case-insensitive, powers of 1024).
+bool parse_bytes(const std::string& s, size_t& out) {
+    size_t digits = 0;
+    while (digits < s.size() && std::isdigit(static_cast<unsigned char>(s[digits]))) ++digits;
+    if (digits == 0) return false;
+    std::string unit = s.substr(digits);
+    std::transform(unit.begin(), unit.end(), unit.begin(),
+                   [](unsigned char ch) { return static_cast<char>(std::tolower(ch)); });
+    size_t scale = 1;
+    if (unit == "kb" || unit == "k") scale = size_t{1} << 10;
+    else if (unit == "mb" || unit == "m") scale = size_t{1} << 20;
+    else if (unit == "gb" || unit == "g") scale = size_t{1} << 30;
+    else if (!unit.empty() && unit != "b") return false;
+    try {
+        out = static_cast<size_t>(std::stoull(s.substr(0, digits))) * scale;
+    } catch (...) {
+        return false;
+    }
+    return true;
+}
+
 void set_value(ServerConfig& c, const std::string& key, const std::string& value) {
     if (key == "port") {
         try {
@@ -30,14 +51,56 @@ void set_value(ServerConfig& c, const std::string& key, const std::string& value
             size_t n = static_cast<size_t>(std::stoull(value));
             if (n > 0 && n <= 1024) c.shard_count = n;
         } catch (...) {}
+    } else if (key == "appendfsync") {
+        if (value == "always" || value == "everysec" || value == "no")
+            c.appendfsync = value;
     } else if (key == "aof_fsync") {
-        std::string v = value;
-        if (v == "no" || v == "0" || v == "false") c.aof_fsync_every_write = false;
+        // Older name: every_write (or yes) is `always`, no is `no`.
+        if (value == "every_write" || value == "yes" || value == "1" || value == "true")
+            c.appendfsync = "always";
+        else if (value == "no" || value == "0" || value == "false")
+            c.appendfsync = "no";
+    } else if (key == "auto_aof_rewrite_percentage") {
+        try {
+            c.auto_aof_rewrite_percentage = static_cast<size_t>(std::stoull(value));
+        } catch (...) {}
+    } else if (key == "auto_aof_rewrite_min_size") {
+        size_t bytes = 0;
+        if (parse_bytes(value, bytes)) c.auto_aof_rewrite_min_size = bytes;
     } else if (key == "worker_threads") {
         try {
             size_t n = static_cast<size_t>(std::stoull(value));
             if (n > 0 && n <= 64) c.worker_threads = n;
         } catch (...) {}
+    } else if (key == "net_threads") {
+        try {
+            size_t n = static_cast<size_t>(std::stoull(value));
+            if (n > 0 && n <= 256) c.net_threads = n;
+        } catch (...) {}
+    } else if (key == "thread_per_core") {
+        c.thread_per_core = (value == "yes" || value == "1" || value == "true");
+    } else if (key == "maxmemory") {
+        size_t bytes = 0;
+        if (parse_bytes(value, bytes)) c.maxmemory = bytes;
+    } else if (key == "maxmemory_policy") {
+        if (value == "noeviction" || value == "allkeys-lru" || value == "allkeys-lfu" ||
+            value == "volatile-ttl")
+            c.maxmemory_policy = value;
+    } else if (key == "maxmemory_samples") {
+        try {
+            size_t n = static_cast<size_t>(std::stoull(value));
+            if (n > 0 && n <= 64) c.maxmemory_samples = n;
+        } catch (...) {}
+    } else if (key == "activedefrag") {
+        c.activedefrag = (value == "yes" || value == "1" || value == "true");
+    } else if (key == "active_defrag_threshold") {
+        try {
+            size_t n = static_cast<size_t>(std::stoull(value));
+            if (n <= 1000) c.active_defrag_threshold = n;
+        } catch (...) {}
+    } else if (key == "io_backend") {
+        if (value == "auto" || value == "epoll" || value == "kqueue" || value == "io_uring")
+            c.io_backend = value == "auto" ? "" : value;
     }
 }
 
@@ -0,0 +1,82 @@
+#include "common/crc32c.hpp"
+
+#include <array>
+#include <bit>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <nmmintrin.h>
+#define MINI_REDIS_CRC32C_SSE42 1
+#endif
+
+namespace mini_redis {
+
+namespace {
+
+constexpr uint32_t POLY = 0x82f63b78;  // reflected Castagnoli polynomial
+
+// TABLES[k][b]: the CRC of byte b followed by k zero bytes.
+constexpr std::array<std::array<uint32_t, 256>, 8> TABLES = [] {
+    std::array<std::array<uint32_t, 256>, 8> t{};
+    for (uint32_t b = 0; b < 256; ++b) {
+        uint32_t c = b;
+        for (int i = 0; i < 8; ++i)
+            c = (c >> 1) ^ (c & 1 ? POLY : 0);
+        t[0][b] = c;
+    }
+    for (size_t k = 1; k < 8; ++k)
+        for (size_t b = 0; b < 256; ++b)
+            t[k][b] = (t[k - 1][b] >> 8) ^ t[0][t[k - 1][b] & 0xff];
+    return t;
+}();
+
+uint32_t crc_bytes(const uint8_t* p, size_t n, uint32_t crc) {
+    while (n--)
+        crc = TABLES[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+    return crc;
+}
+
+uint32_t crc_tables(const uint8_t* p, size_t n, uint32_t crc) {
+    if constexpr (std::endian::native != std::endian::little)
+        return crc_bytes(p, n, crc);
+    for (; n >= 8; p += 8, n -= 8) {
+        uint64_t v;
+        std::memcpy(&v, p, 8);
+        v ^= crc;
+        crc = TABLES[7][v & 0xff] ^ TABLES[6][(v >> 8) & 0xff] ^
+              TABLES[5][(v >> 16) & 0xff] ^ TABLES[4][(v >> 24) & 0xff] ^
+              TABLES[3][(v >> 32) & 0xff] ^ TABLES[2][(v >> 40) & 0xff] ^
+              TABLES[1][(v >> 48) & 0xff] ^ TABLES[0][v >> 56];
+    }
+    return crc_bytes(p, n, crc);
+}
+
+#if defined(MINI_REDIS_CRC32C_SSE42)
+__attribute__((target("sse4.2")))
+uint32_t crc_sse42(const uint8_t* p, size_t n, uint32_t crc) {
+    uint64_t c = crc;
+    for (; n >= 8; p += 8, n -= 8) {
+        uint64_t v;
+        std::memcpy(&v, p, 8);
+        c = _mm_crc32_u64(c, v);
+    }
+    crc = static_cast<uint32_t>(c);
+    while (n--)
+        crc = _mm_crc32_u8(crc, *p++);
+    return crc;
+}
+#endif
+
+} // namespace
+
+uint32_t crc32c(const void* data, size_t len, uint32_t crc) {
+    const auto* p = static_cast<const uint8_t*>(data);
+#if defined(MINI_REDIS_CRC32C_SSE42)
+    static const bool sse42 = __builtin_cpu_supports("sse4.2");
+    if (sse42)
+        return ~crc_sse42(p, len, ~crc);
+#endif
+    return ~crc_tables(p, len, ~crc);
+}
+
+} // namespace mini_redis
@@ -0,0 +1,113 @@
+#include "common/glob.hpp"
+
+namespace mini_redis {
+
+Glob::Glob(std::string_view pattern) {
+    std::vector<Token> tokens;
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        char c = pattern[i];
+        if (c == '*') {
+            if (tokens.empty() || tokens.back().op != Op::STAR)
+                tokens.push_back({Op::STAR, 0, 0});
+        } else if (c == '?') {
+            tokens.push_back({Op::ANY, 0, 0});
+        } else if (c == '\\' && i + 1 < pattern.size()) {
+            tokens.push_back({Op::LITERAL, pattern[++i], 0});
+        } else if (c == '[' && pattern.find(']', i + 2) != std::string_view::npos) {
+            // The first character after [ (or [^) is never the closing ].
+            std::bitset<256> set;
+            size_t j = i + 1;
+            bool negate = pattern[j] == '^' || pattern[j] == '!';
+            if (negate)
+                ++j;
+            size_t first = j;
+            for (; j < pattern.size() && (pattern[j] != ']' || j == first); ++j) {
+                unsigned char lo = static_cast<unsigned char>(pattern[j]);
+                if (lo == '\\' && j + 1 < pattern.size()) {
+                    set.set(static_cast<unsigned char>(pattern[++j]));
+                } else if (j + 2 < pattern.size() && pattern[j + 1] == '-' && pattern[j + 2] != ']') {
+                    unsigned char hi = static_cast<unsigned char>(pattern[j + 2]);
+                    if (lo > hi)
+                        std::swap(lo, hi);
+                    for (unsigned v = lo; v <= hi; ++v)
+                        set.set(v);
+                    j += 2;
+                } else {
+                    set.set(lo);
+                }
+            }
+            if (j == pattern.size()) {
+                // The only ] was escaped or part of a range: [ is literal.
+                tokens.push_back({Op::LITERAL, c, 0});
+                continue;
+            }
+            if (negate)
+                set.flip();
+            classes_.push_back(set);
+            tokens.push_back({Op::CLASS, 0, static_cast<uint32_t>(classes_.size() - 1)});
+            i = j;
+        } else {
+            tokens.push_back({Op::LITERAL, c, 0});
+        }
+    }
+
+    size_t lead = 0;
+    while (lead < tokens.size() && tokens[lead].op == Op::LITERAL)
+        prefix_ += tokens[lead++].ch;
+    if (lead == tokens.size()) {
+        shape_ = Shape::EXACT;
+    } else if (lead + 1 == tokens.size() && tokens[lead].op == Op::STAR) {
+        shape_ = Shape::PREFIX;
+    } else {
+        shape_ = Shape::GENERAL;
+        tokens_.assign(tokens.begin() + static_cast<std::ptrdiff_t>(lead), tokens.end());
+    }
+}
+
+bool Glob::matches(std::string_view key) const {
+    if (key.size() < prefix_.size() || key.compare(0, prefix_.size(), prefix_) != 0)
+        return false;
+    switch (shape_) {
+    case Shape::EXACT:
+        return key.size() == prefix_.size();
+    case Shape::PREFIX:
+        return true;
+    default:
+        return match_tokens(key.substr(prefix_.size()));
+    }
+}
+
+// Every token but STAR consumes one byte, so one backtrack point (the last
+// star seen) is enough: linear in practice, O(key * pattern) at worst.
+bool Glob::match_tokens(std::string_view key) const {
+    size_t t = 0, k = 0;
+    size_t star_t = SIZE_MAX, star_k = 0;
+    while (k < key.size()) {
+        if (t < tokens_.size()) {
+            const Token& tok = tokens_[t];
+            if (tok.op == Op::STAR) {
+                star_t = t++;
+                star_k = k;
+                continue;
+            }
+            unsigned char c = static_cast<unsigned char>(key[k]);
+            bool ok = tok.op == Op::ANY ||
+                      (tok.op == Op::LITERAL && static_cast<unsigned char>(tok.ch) == c) ||
+                      (tok.op == Op::CLASS && classes_[tok.klass].test(c));
+            if (ok) {
+                ++t;
+                ++k;
+                continue;
+            }
+        }
+        if (star_t == SIZE_MAX)
+            return false;
+        t = star_t + 1;
+        k = ++star_k;
+    }
+    while (t < tokens_.size() && tokens_[t].op == Op::STAR)
+        ++t;
+    return t == tokens_.size();
+}
+
+} // namespace mini_redis
@@ -0,0 +1,76 @@
+#include "common/memory_stats.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+namespace mini_redis {
+
+namespace {
+
+constexpr size_t KINDS = static_cast<size_t>(MemoryKind::COUNT);
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<memory_detail::ThreadCounters*> threads;
+    int64_t retired[KINDS] = {};  // totals of threads that have exited
+};
+
+Registry& registry() {
+    static Registry* r = new Registry;  // outlives every thread_local
+    return *r;
+}
+
+} // namespace
+
+namespace memory_detail {
+
+ThreadCounters::ThreadCounters() {
+    Registry& r = registry();
+    std::lock_guard lock(r.mutex);
+    r.threads.push_back(this);
+}
+
+ThreadCounters::~ThreadCounters() {
+    Registry& r = registry();
+    std::lock_guard lock(r.mutex);
+    for (size_t k = 0; k < KINDS; ++k)
+        r.retired[k] += bytes[k].load(std::memory_order_relaxed);
+    r.threads.erase(std::find(r.threads.begin(), r.threads.end(), this));
+}
+
+ThreadCounters& local() {
+    thread_local ThreadCounters counters;
+    return counters;
+}
+
+} // namespace memory_detail
+
+size_t memory_used(MemoryKind kind) {
+    size_t k = static_cast<size_t>(kind);
+    Registry& r = registry();
+    std::lock_guard lock(r.mutex);
+    int64_t total = r.retired[k];
+    for (const auto* t : r.threads)
+        total += t->bytes[k].load(std::memory_order_relaxed);
+    return total > 0 ? static_cast<size_t>(total) : 0;
+}
+
+size_t resident_bytes() {
+#ifdef __linux__
+    FILE* f = std::fopen("/proc/self/statm", "r");
+    if (!f)
+        return 0;
+    unsigned long size = 0, resident = 0;
+    int n = std::fscanf(f, "%lu %lu", &size, &resident);
+    std::fclose(f);
+    return n == 2 ? resident * static_cast<size_t>(sysconf(_SC_PAGESIZE)) : 0;
+#else
+    return 0;
+#endif
+}
+
+} // namespace mini_redis
@@ -0,0 +1,45 @@
+#include "common/time.hpp"
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+namespace mini_redis {
+
+namespace {
+
+constexpr auto TICK = std::chrono::milliseconds(1);
+
+int64_t steady_ms() {
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+int64_t wall_offset_ms() {
+    using namespace std::chrono;
+    static const int64_t offset =
+        duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count() - steady_ms();
+    return offset;
+}
+
+} // namespace
+
+uint64_t precise_now_ms() {
+    return static_cast<uint64_t>(steady_ms() + wall_offset_ms());
+}
+
+void start_clock_ticker() {
+    static std::once_flag once;
+    static std::jthread ticker;
+    std::call_once(once, [] {
+        time_detail::cached_ms.store(precise_now_ms(), std::memory_order_relaxed);
+        ticker = std::jthread([](std::stop_token stop) {
+            while (!stop.stop_requested()) {
+                std::this_thread::sleep_for(TICK);
+                time_detail::cached_ms.store(precise_now_ms(), std::memory_order_relaxed);
+            }
+        });
+    });
+}
+
+} // namespace mini_redis
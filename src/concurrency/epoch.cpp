@@ -0,0 +1,162 @@
+#include "concurrency/epoch.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace mini_redis::concurrency {
+
+namespace {
+
+constexpr uint64_t UNPINNED = 0;       // epochs start at 1
+constexpr size_t COLLECT_INTERVAL = 64;  // retires between reclamation attempts
+
+struct Retired {
+    void* ptr;
+    void (*deleter)(void*);
+    uint64_t epoch;  // global epoch when it was retired
+};
+
+// One per thread, on its own cache line; recycled after the thread exits.
+struct alignas(64) Record {
+    std::atomic<uint64_t> epoch{UNPINNED};
+    std::atomic<bool> in_use{true};
+    Record* next = nullptr;
+};
+
+struct Domain {
+    alignas(64) std::atomic<uint64_t> global{1};
+    std::atomic<Record*> records{nullptr};  // append-only
+
+    std::mutex orphans_mutex;
+    std::vector<Retired> orphans;  // left behind by exited threads
+
+    ~Domain() {
+        // Process exit: no readers remain.
+        for (const Retired& r : orphans)
+            r.deleter(r.ptr);
+    }
+};
+
+Domain& domain() {
+    static Domain d;
+    return d;
+}
+
+// Move to the next epoch if every pinned thread has observed this one.
+uint64_t try_advance() {
+    Domain& d = domain();
+    uint64_t global = d.global.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    for (Record* r = d.records.load(std::memory_order_acquire); r; r = r->next) {
+        uint64_t e = r->epoch.load(std::memory_order_acquire);
+        if (e != UNPINNED && e != global)
+            return global;
+    }
+    d.global.compare_exchange_strong(global, global + 1,
+                                     std::memory_order_acq_rel, std::memory_order_acquire);
+    return d.global.load(std::memory_order_acquire);
+}
+
+// Free everything retired at least two epochs before `global`.
+void collect(std::vector<Retired>& list, uint64_t global) {
+    size_t kept = 0;
+    for (Retired& r : list) {
+        if (r.epoch + 2 <= global)
+            r.deleter(r.ptr);
+        else
+            list[kept++] = r;
+    }
+    list.resize(kept);
+}
+
+struct ThreadState {
+    Record* record;
+    unsigned depth = 0;
+    std::vector<Retired> limbo;
+    size_t since_collect = 0;
+
+    ThreadState() {
+        Domain& d = domain();
+        for (Record* r = d.records.load(std::memory_order_acquire); r; r = r->next) {
+            bool free = false;
+            if (r->in_use.compare_exchange_strong(free, true)) {
+                record = r;
+                return;
+            }
+        }
+        record = new Record;
+        record->next = d.records.load(std::memory_order_relaxed);
+        while (!d.records.compare_exchange_weak(record->next, record,
+                                                std::memory_order_release,
+                                                std::memory_order_relaxed)) {
+        }
+    }
+
+    ~ThreadState() {
+        record->epoch.store(UNPINNED, std::memory_order_release);
+        if (!limbo.empty()) {
+            Domain& d = domain();
+            std::lock_guard lock(d.orphans_mutex);
+            d.orphans.insert(d.orphans.end(), limbo.begin(), limbo.end());
+        }
+        record->in_use.store(false, std::memory_order_release);
+    }
+};
+
+ThreadState& local() {
+    thread_local ThreadState state;
+    return state;
+}
+
+} // namespace
+
+EpochGuard::EpochGuard(bool pin) : pinned_(pin) {
+    if (!pin)
+        return;
+    ThreadState& s = local();
+    if (s.depth++ == 0) {
+        s.record->epoch.store(domain().global.load(std::memory_order_relaxed),
+                              std::memory_order_relaxed);
+        // Pairs with the fence in try_advance(): either the advancing thread
+        // sees this pin, or this thread sees everything unlinked before it.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+}
+
+EpochGuard::~EpochGuard() {
+    if (!pinned_)
+        return;
+    ThreadState& s = local();
+    if (--s.depth == 0)
+        s.record->epoch.store(UNPINNED, std::memory_order_release);
+}
+
+void retire(void* p, void (*deleter)(void*)) {
+    ThreadState& s = local();
+    s.limbo.push_back({p, deleter, domain().global.load(std::memory_order_relaxed)});
+    if (++s.since_collect < COLLECT_INTERVAL)
+        return;
+    s.since_collect = 0;
+
+    uint64_t global = try_advance();
+    collect(s.limbo, global);
+
+    Domain& d = domain();
+    std::unique_lock lock(d.orphans_mutex, std::try_to_lock);
+    if (lock.owns_lock() && !d.orphans.empty())
+        collect(d.orphans, global);
+}
+
+void flush_retired() {
+    ThreadState& s = local();
+    if (s.limbo.empty())
+        return;
+    s.since_collect = 0;
+    // Two advances put everything retired so far out of readers' reach.
+    try_advance();
+    collect(s.limbo, try_advance());
+}
+
+} // namespace mini_redis::concurrency
@@ -1,5 +1,10 @@
 #include "concurrency/thread_pool.hpp"
 
+#include "concurrency/epoch.hpp"
+
+#include <algorithm>
+#include <memory>
+
 namespace mini_redis::concurrency {
 
 ThreadPool::ThreadPool(size_t num_threads) {
@@ -33,11 +38,50 @@ void ThreadPool::shutdown() {
     }
 }
 
+void ThreadPool::parallel_for(size_t n, const std::function<void(size_t)>& fn) {
+    struct Job {
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> done{0};
+        size_t n = 0;
+        const std::function<void(size_t)>* fn = nullptr;
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+    auto job = std::make_shared<Job>();
+    job->n = n;
+    job->fn = &fn;
+
+    // A helper that starts after every index is claimed touches nothing but
+    // the counters, so `fn` only has to outlive this call.
+    auto run = [job] {
+        for (size_t i; (i = job->next.fetch_add(1)) < job->n;) {
+            (*job->fn)(i);
+            if (job->done.fetch_add(1) + 1 == job->n) {
+                std::lock_guard lock(job->mutex);
+                job->finished.notify_all();
+            }
+        }
+    };
+
+    size_t helpers = std::min(workers_.size(), n > 0 ? n - 1 : 0);
+    for (size_t h = 0; h < helpers; ++h)
+        enqueue(run);
+    run();
+
+    std::unique_lock lock(job->mutex);
+    job->finished.wait(lock, [&] { return job->done.load() == job->n; });
+}
+
 void ThreadPool::worker() {
     while (true) {
         std::function<void()> task;
         {
             std::unique_lock<std::mutex> lock(queue_mutex_);
+            if (tasks_.empty() && !stop_) {
+                lock.unlock();
+                flush_retired();  // before idling, free what this worker replaced
+                lock.lock();
+            }
             condition_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
             if (stop_ && tasks_.empty()) return;
             task = std::move(tasks_.front());
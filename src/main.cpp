@@ -1,6 +1,7 @@
 #include "storage/storage_engine.hpp"
 #include "net/server.hpp"
 #include "common/config.hpp"
+#include "common/time.hpp"
 
 #include <iostream>
 
@@ -8,10 +9,23 @@ int main() {
     mini_redis::ServerConfig config =
         mini_redis::load_config("config/server.conf");
 
+    mini_redis::start_clock_ticker();
+
     mini_redis::StorageEngine engine(config.shard_count);
-    engine.enable_aof(config.aof_file, config.aof_fsync_every_write);
+    mini_redis::EvictionPolicy policy = mini_redis::EvictionPolicy::NOEVICTION;
+    mini_redis::parse_eviction_policy(config.maxmemory_policy, policy);
+    engine.set_maxmemory(config.maxmemory, policy, config.maxmemory_samples);
+    engine.set_active_defrag(config.activedefrag, config.active_defrag_threshold);
+    mini_redis::AofFsync fsync_policy = mini_redis::AofFsync::EVERYSEC;
+    mini_redis::parse_aof_fsync(config.appendfsync, fsync_policy);
+    if (!engine.enable_aof(config.aof_file, fsync_policy)) {
+        std::cerr << "Failed to load AOF " << config.aof_file << "\n";
+        return 1;
+    }
+    engine.aof_rewriter()->set_auto(config.auto_aof_rewrite_percentage,
+                                    config.auto_aof_rewrite_min_size);
 
-    net::Server server(config.port, engine, config.worker_threads);
+    net::Server server(config, engine);
     if (!server.start()) {
         std::cerr << "Failed to start server\n";
         return 1;
@@ -0,0 +1,120 @@
+#include "net/buffer.hpp"
+
+#include <utility>
+
+namespace net {
+
+namespace {
+
+constexpr size_t MAX_POOLED_BUFFERS = 256;
+constexpr size_t MAX_POOLED_CAPACITY = 256 * 1024;
+
+} // namespace
+
+std::string BufferPool::acquire() {
+    if (free_.empty()) {
+        std::string buf;
+        buf.reserve(CHUNK_SIZE);
+        return buf;
+    }
+    std::string buf = std::move(free_.back());
+    free_.pop_back();
+    return buf;
+}
+
+void BufferPool::release(std::string&& buf) {
+    if (buf.capacity() < CHUNK_SIZE || buf.capacity() > MAX_POOLED_CAPACITY ||
+        free_.size() >= MAX_POOLED_BUFFERS)
+        return;
+    buf.clear();
+    free_.push_back(std::move(buf));
+}
+
+std::string& OutputBuffer::tail() {
+    if (segments_.empty() || segments_.back().blob ||
+        segments_.back().bytes.size() >= BufferPool::CHUNK_SIZE)
+        segments_.push_back({pool_ ? pool_->acquire() : std::string(), {}});
+    return segments_.back().bytes;
+}
+
+void OutputBuffer::append(std::string&& data) {
+    if (data.empty())
+        return;
+    // Copying a short reply into the open chunk keeps the iovec count down;
+    // anything bigger is linked in as is.
+    if (!segments_.empty() && !segments_.back().blob &&
+        segments_.back().bytes.size() + data.size() <= BufferPool::CHUNK_SIZE &&
+        segments_.back().bytes.capacity() >= BufferPool::CHUNK_SIZE) {
+        segments_.back().bytes += data;
+        if (pool_)
+            pool_->release(std::move(data));
+        return;
+    }
+    segments_.push_back({std::move(data), {}});
+}
+
+void OutputBuffer::append(OutputBuffer&& other) {
+    // `other` has sent nothing, so its offset is zero.
+    for (Segment& seg : other.segments_) {
+        if (seg.blob)
+            segments_.push_back(std::move(seg));
+        else
+            append(std::move(seg.bytes));
+    }
+    other.segments_.clear();
+}
+
+void OutputBuffer::link(mini_redis::BlobRef blob) {
+    if (blob)
+        segments_.push_back({std::string(), std::move(blob)});
+}
+
+void OutputBuffer::open(std::string&& chunk) {
+    segments_.push_back({std::move(chunk), {}});
+}
+
+size_t OutputBuffer::gather(iovec* iov, size_t max) const {
+    size_t n = 0;
+    size_t skip = offset_;
+    for (auto it = segments_.begin(); it != segments_.end() && n < max; ++it) {
+        std::string_view data = it->data();
+        iov[n].iov_base = const_cast<char*>(data.data()) + skip;
+        iov[n].iov_len = data.size() - skip;
+        skip = 0;
+        ++n;
+    }
+    return n;
+}
+
+void OutputBuffer::consume(size_t n) {
+    while (!segments_.empty()) {
+        size_t left = segments_.front().data().size() - offset_;
+        if (n < left) {
+            offset_ += n;
+            return;
+        }
+        n -= left;
+        offset_ = 0;
+        release(segments_.front());
+        segments_.pop_front();
+    }
+}
+
+void OutputBuffer::release(Segment& seg) {
+    if (pool_ && !seg.blob)
+        pool_->release(std::move(seg.bytes));
+}
+
+void OutputBuffer::swap(OutputBuffer& other) {
+    segments_.swap(other.segments_);
+    std::swap(offset_, other.offset_);
+}
+
+size_t OutputBuffer::memory_bytes() const {
+    size_t bytes = 0;
+    for (const Segment& seg : segments_)
+        bytes += heap_capacity(seg.bytes);
+    return bytes;
+}
+
+} // namespace net
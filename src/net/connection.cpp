@@ -1,78 +1,173 @@
 #include "net/connection.hpp"
 
+#include "net/socket.hpp"
+#include "common/memory_stats.hpp"
+
 #include <unistd.h>
 #include <errno.h>
+#include <algorithm>
 #include <cstdint>
 
 namespace net {
 
-Connection::Connection(int fd, SubmitFn submit_fn)
+namespace {
+
+constexpr size_t READ_CHUNK = BufferPool::CHUNK_SIZE;
+constexpr size_t MAX_READ_CHUNK = 1024 * 1024;
+constexpr size_t WRITE_IOVS = 64;
+
+} // namespace
+
+Connection::Connection(int fd, SubmitFn submit_fn, BufferPool& pool)
     : fd_(fd),
-      submit_fn_(std::move(submit_fn)) {}
+      submit_fn_(std::move(submit_fn)),
+      pool_(pool),
+      read_buffer_(pool.acquire()),
+      write_buffer_(&pool) {}
 
 Connection::~Connection() {
     if (fd_ >= 0)
         close(fd_);
+    mini_redis::memory_add(mini_redis::MemoryKind::CLIENT_BUFFERS, -static_cast<int64_t>(accounted_));
+    pool_.release(std::move(read_buffer_));
 }
 
 int Connection::fd() const {
     return fd_;
 }
 
-bool Connection::handle_read() {
-    char buffer[4096];
-    ssize_t n = read(fd_, buffer, sizeof(buffer));
-
-    if (n > 0) {
-        read_buffer_.append(buffer, n);
-        process_buffer();
-        return true;
+void Connection::account_memory() {
+    size_t bytes = heap_capacity(read_buffer_) + write_buffer_.memory_bytes();
+    if (bytes != accounted_) {
+        mini_redis::memory_add(mini_redis::MemoryKind::CLIENT_BUFFERS,
+                               static_cast<int64_t>(bytes) - static_cast<int64_t>(accounted_));
+        accounted_ = bytes;
     }
-    if (n == 0)
-        return false;
-    if (errno == EAGAIN || errno == EWOULDBLOCK)
-        return true;
-    return false;
 }
 
-bool Connection::process_buffer() {
-    size_t pos = 0;
+bool Connection::handle_read() {
+    bool ok = read_input();
+    account_memory();
+    return ok;
+}
 
+bool Connection::read_input() {
+    // Edge-triggered: keep reading until the socket reports EAGAIN. Bytes go
+    // straight into read_buffer_, and each read is parsed as it lands, so a
+    // large bulk payload's length is known early and its whole frame is
+    // allocated once rather than grown (and copied) repeatedly.
     while (true) {
-        std::vector<std::string> cmd;
-        if (!parser_.parse_array(read_buffer_, pos, cmd))
-            break;
-        if (cmd.empty())
+        if (read_buffer_.capacity() == 0)
+            read_buffer_ = pool_.acquire();
+        size_t needed = parser_.bytes_needed();
+        size_t chunk = READ_CHUNK;
+        if (needed > 0) {
+            size_t frame_end = parsed_ + needed;
+            if (read_buffer_.capacity() < frame_end)
+                read_buffer_.reserve(frame_end);
+            if (frame_end > read_buffer_.size())
+                chunk = std::clamp(frame_end - read_buffer_.size(), READ_CHUNK, MAX_READ_CHUNK);
+        }
+
+        size_t old_size = read_buffer_.size();
+        read_buffer_.resize(old_size + chunk);
+        ssize_t n = read(fd_, read_buffer_.data() + old_size, chunk);
+        read_buffer_.resize(old_size + (n > 0 ? static_cast<size_t>(n) : 0));
+
+        if (n > 0) {
+            if (!parse_input())
+                return false;
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
             continue;
-        submit_fn_(fd_, std::move(cmd));
+
+        int err = errno;
+        submit_batch();
+        if (n == 0)
+            return false;
+        return err == EAGAIN || err == EWOULDBLOCK;
     }
+}
 
-    read_buffer_.erase(0, pos);
+bool Connection::on_data(const char* data, size_t n) {
+    read_buffer_.append(data, n);
+    bool ok = parse_input();
+    if (ok)
+        submit_batch();
+    account_memory();
+    return ok;
+}
+
+bool Connection::parse_input() {
+    while (parsed_ < read_buffer_.size()) {
+        std::string_view frame(read_buffer_.data() + parsed_, read_buffer_.size() - parsed_);
+        auto status = parser_.parse(frame);
+        if (status == protocol::RespParser::Status::INCOMPLETE)
+            return true;
+        if (status == protocol::RespParser::Status::ERROR)
+            return false;
+        if (!parser_.args().empty())
+            batch_.add(parsed_, parser_.args());
+        parsed_ += parser_.frame_size();
+    }
     return true;
 }
 
-void Connection::add_pending_response(std::string response) {
-    std::lock_guard lock(write_mutex_);
-    write_buffer_ += std::move(response);
+void Connection::submit_batch() {
+    if (batch_.empty()) {
+        read_buffer_.erase(0, parsed_);
+        parsed_ = 0;
+        return;
+    }
+    // The batch takes the whole read buffer. Only an unfinished trailing
+    // frame, if any, is copied into a fresh buffer to continue from.
+    std::string rest;
+    if (parsed_ < read_buffer_.size()) {
+        rest = pool_.acquire();
+        rest.append(read_buffer_, parsed_, std::string::npos);
+    }
+    batch_.adopt(read_buffer_);
+    read_buffer_.swap(rest);
+    parsed_ = 0;
+    Batch batch;
+    std::swap(batch, batch_);
+    submit_fn_(fd_, std::move(batch));
+}
+
+void Connection::add_pending_response(OutputBuffer&& response) {
+    write_buffer_.append(std::move(response));
+    account_memory();
 }
 
 bool Connection::handle_write() {
-    std::lock_guard lock(write_mutex_);
-    if (write_buffer_.empty())
-        return true;
+    // Gather every queued chunk into one sendmsg/writev until EAGAIN.
+    iovec iov[WRITE_IOVS];
+    while (!write_buffer_.empty()) {
+        size_t count = write_buffer_.gather(iov, WRITE_IOVS);
+        ssize_t n = send_iov(fd_, iov, count);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            bool ok = errno == EAGAIN || errno == EWOULDBLOCK;
+            account_memory();
+            return ok;
+        }
+        write_buffer_.consume(static_cast<size_t>(n));
+    }
+    account_memory();
+    return true;
+}
 
-    ssize_t n = write(fd_, write_buffer_.data(), write_buffer_.size());
-    if (n < 0) {
-        if (errno == EAGAIN || errno == EWOULDBLOCK)
-            return true;
+bool Connection::take_output(OutputBuffer& out) {
+    if (write_buffer_.empty())
         return false;
-    }
-    write_buffer_.erase(0, static_cast<size_t>(n));
+    out.swap(write_buffer_);
+    account_memory();
     return true;
 }
 
 bool Connection::wants_write() const {
-    std::lock_guard lock(write_mutex_);
     return !write_buffer_.empty();
 }
 
@@ -0,0 +1,262 @@
+#include "net/event_loop.hpp"
+
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#else
+#include <sys/event.h>
+#include <sys/time.h>
+#endif
+
+namespace net {
+
+namespace {
+
+constexpr int MAX_EVENTS = 256;
+
+#if defined(__linux__)
+
+class EpollEventLoop : public EventLoop {
+public:
+    ~EpollEventLoop() override {
+        if (wake_fd_ >= 0) close(wake_fd_);
+        if (ep_ >= 0) close(ep_);
+    }
+
+    bool open() override {
+        ep_ = epoll_create1(EPOLL_CLOEXEC);
+        if (ep_ < 0) {
+            perror("epoll_create1");
+            return false;
+        }
+        wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (wake_fd_ < 0) {
+            perror("eventfd");
+            return false;
+        }
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLET;
+        ev.data.fd = wake_fd_;
+        epoll_ctl(ep_, EPOLL_CTL_ADD, wake_fd_, &ev);
+        events_.resize(MAX_EVENTS);
+        return true;
+    }
+
+    const char* name() const override { return "epoll"; }
+
+    void wakeup() override {
+        uint64_t one = 1;
+        ssize_t r = write(wake_fd_, &one, sizeof(one));
+        (void)r;  // EAGAIN only if the counter is saturated: already signalled
+    }
+
+protected:
+    void remove_now(int fd, uint32_t) override {
+        epoll_ctl(ep_, EPOLL_CTL_DEL, fd, nullptr);
+    }
+
+    int poll(const std::vector<Change>& changes,
+             std::vector<IoEvent>& out,
+             int timeout_ms) override {
+        // epoll has no batched ctl; coalescing in EventLoop::wait already
+        // reduced this to one call per fd whose mask actually changed.
+        for (const Change& c : changes) {
+            if (c.new_mask == 0) {
+                epoll_ctl(ep_, EPOLL_CTL_DEL, c.fd, nullptr);
+                continue;
+            }
+            epoll_event ev{};
+            ev.events = EPOLLET | EPOLLRDHUP;
+            if (c.new_mask & READABLE) ev.events |= EPOLLIN;
+            if (c.new_mask & WRITABLE) ev.events |= EPOLLOUT;
+            ev.data.fd = c.fd;
+            int op = c.old_mask == 0 ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+            epoll_ctl(ep_, op, c.fd, &ev);
+        }
+
+        int n = epoll_wait(ep_, events_.data(), static_cast<int>(events_.size()), timeout_ms);
+        if (n < 0)
+            return -1;
+
+        out.clear();
+        for (int i = 0; i < n; ++i) {
+            if (events_[i].data.fd == wake_fd_) {
+                uint64_t count;
+                ssize_t r = read(wake_fd_, &count, sizeof(count));
+                (void)r;
+                continue;
+            }
+            uint32_t e = events_[i].events;
+            uint32_t mask = 0;
+            if (e & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) mask |= READABLE;
+            if (e & (EPOLLOUT | EPOLLHUP | EPOLLERR)) mask |= WRITABLE;
+            out.push_back({events_[i].data.fd, mask});
+        }
+        return static_cast<int>(out.size());
+    }
+
+private:
+    int ep_ = -1;
+    int wake_fd_ = -1;
+    std::vector<epoll_event> events_;
+};
+
+#else
+
+class KqueueEventLoop : public EventLoop {
+public:
+    ~KqueueEventLoop() override {
+        if (kq_ >= 0) close(kq_);
+    }
+
+    bool open() override {
+        kq_ = kqueue();
+        if (kq_ < 0) {
+            perror("kqueue");
+            return false;
+        }
+        struct kevent ev;
+        EV_SET(&ev, WAKE_IDENT, EVFILT_USER, EV_ADD | EV_CLEAR, 0, 0, nullptr);
+        if (kevent(kq_, &ev, 1, nullptr, 0, nullptr) < 0) {
+            perror("kevent EVFILT_USER");
+            return false;
+        }
+        events_.resize(MAX_EVENTS);
+        return true;
+    }
+
+    const char* name() const override { return "kqueue"; }
+
+    void wakeup() override {
+        struct kevent ev;
+        EV_SET(&ev, WAKE_IDENT, EVFILT_USER, 0, NOTE_TRIGGER, 0, nullptr);
+        kevent(kq_, &ev, 1, nullptr, 0, nullptr);
+    }
+
+protected:
+    void remove_now(int fd, uint32_t old_mask) override {
+        struct kevent evs[2];
+        int n = 0;
+        if (old_mask & READABLE)
+            EV_SET(&evs[n++], fd, EVFILT_READ, EV_DELETE, 0, 0, nullptr);
+        if (old_mask & WRITABLE)
+            EV_SET(&evs[n++], fd, EVFILT_WRITE, EV_DELETE, 0, 0, nullptr);
+        if (n > 0)
+            kevent(kq_, evs, n, nullptr, 0, nullptr);
+    }
+
+    int poll(const std::vector<Change>& changes,
+             std::vector<IoEvent>& out,
+             int timeout_ms) override {
+        // The whole changelist rides along with the wait in one kevent call.
+        changelist_.clear();
+        for (const Change& c : changes) {
+            uint32_t diff = c.old_mask ^ c.new_mask;
+            struct kevent ev;
+            if (diff & READABLE) {
+                EV_SET(&ev, c.fd, EVFILT_READ,
+                       (c.new_mask & READABLE) ? (EV_ADD | EV_CLEAR) : EV_DELETE,
+                       0, 0, nullptr);
+                changelist_.push_back(ev);
+            }
+            if ((diff | c.new_mask) & WRITABLE) {
+                EV_SET(&ev, c.fd, EVFILT_WRITE,
+                       (c.new_mask & WRITABLE) ? (EV_ADD | EV_CLEAR) : EV_DELETE,
+                       0, 0, nullptr);
+                changelist_.push_back(ev);
+            }
+        }
+
+        struct timespec ts;
+        struct timespec* tsp = nullptr;
+        if (timeout_ms >= 0) {
+            ts.tv_sec = timeout_ms / 1000;
+            ts.tv_nsec = static_cast<long>(timeout_ms % 1000) * 1000000L;
+            tsp = &ts;
+        }
+
+        int n = kevent(kq_,
+                       changelist_.empty() ? nullptr : changelist_.data(),
+                       static_cast<int>(changelist_.size()),
+                       events_.data(),
+                       static_cast<int>(events_.size()),
+                       tsp);
+        if (n < 0)
+            return -1;
+
+        out.clear();
+        for (int i = 0; i < n; ++i) {
+            const struct kevent& ev = events_[i];
+            if (ev.flags & EV_ERROR)
+                continue;  // failed change (e.g. fd already closed)
+            if (ev.filter == EVFILT_USER)
+                continue;  // wakeup(); EV_CLEAR already reset it
+            uint32_t mask = 0;
+            if (ev.filter == EVFILT_READ) mask |= READABLE;
+            if (ev.filter == EVFILT_WRITE) mask |= WRITABLE;
+            out.push_back({static_cast<int>(ev.ident), mask});
+        }
+        return static_cast<int>(out.size());
+    }
+
+private:
+    static constexpr uintptr_t WAKE_IDENT = 0;
+
+    int kq_ = -1;
+    std::vector<struct kevent> events_;
+    std::vector<struct kevent> changelist_;
+};
+
+#endif
+
+} // namespace
+
+void EventLoop::watch(int fd, uint32_t mask) {
+    pending_[fd] = mask;
+}
+
+void EventLoop::unwatch(int fd) {
+    pending_.erase(fd);
+    auto it = interest_.find(fd);
+    if (it == interest_.end())
+        return;
+    remove_now(fd, it->second);
+    interest_.erase(it);
+}
+
+int EventLoop::wait(std::vector<IoEvent>& out, int timeout_ms) {
+    changes_.clear();
+    for (const auto& [fd, mask] : pending_) {
+        auto it = interest_.find(fd);
+        uint32_t old_mask = it == interest_.end() ? 0 : it->second;
+        // An unchanged mask that includes WRITABLE is still sent: the caller
+        // cleared and re-set write interest since the last wait, and with
+        // edge triggering only a re-arm reports an already-writable socket.
+        if (old_mask == mask && !(mask & WRITABLE))
+            continue;
+        changes_.push_back({fd, old_mask, mask});
+        if (mask == 0)
+            interest_.erase(fd);
+        else
+            interest_[fd] = mask;
+    }
+    pending_.clear();
+    return poll(changes_, out, timeout_ms);
+}
+
+std::unique_ptr<EventLoop> make_event_loop(const std::string& backend) {
+#if defined(__linux__)
+    if (backend.empty() || backend == "auto" || backend == "epoll")
+        return std::make_unique<EpollEventLoop>();
+#else
+    if (backend.empty() || backend == "auto" || backend == "kqueue")
+        return std::make_unique<KqueueEventLoop>();
+#endif
+    return nullptr;
+}
+
+} // namespace net
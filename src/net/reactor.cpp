@@ -0,0 +1,887 @@
+#include "net/reactor.hpp"
+#include "net/connection.hpp"
+#include "net/socket.hpp"
+#include "protocol/executor.hpp"
+
+#include <unistd.h>
+#include <sys/socket.h>
+#if defined(__linux__)
+#include <sys/eventfd.h>
+#endif
+
+#include <algorithm>
+#include <charconv>
+#include <iostream>
+#include <vector>
+#include <cerrno>
+
+namespace net {
+
+namespace {
+
+using mini_redis::protocol::CommandArgs;
+
+std::vector<std::string_view> views_of(const std::vector<std::string>& cmd) {
+    return {cmd.begin(), cmd.end()};
+}
+
+OutputBuffer reply_of(std::string text) {
+    OutputBuffer reply;
+    reply.append(std::move(text));
+    return reply;
+}
+
+constexpr int MAX_EVENTS = 256;
+constexpr size_t MESH_QUEUE_CAPACITY = 1024;
+constexpr int MESH_BACKOFF_MS = 1;  // retry interval while a peer's inbox is full
+
+} // namespace
+
+struct Reactor::CoreMessage {
+    bool is_reply = false;
+    size_t origin = 0;       // core owning the client connection
+    int fd = -1;
+    uint64_t serial = 0;     // MeshConn::serial, guards against fd reuse
+    std::vector<std::string> cmd;
+    OutputBuffer reply;      // whole command: may link stored values
+    std::string result;      // part of a split command: merged as text
+    FanOut* fan = nullptr;   // set when this is one part of a split command
+    uint64_t lsn = 0;        // AOF record the command wrote, if any
+};
+
+// A command whose keys span several cores (multi-key DEL/EXISTS), or that
+// covers every shard (KEYS, DBSIZE, FLUSHALL), is split into one sub-command
+// per owner; the parts' replies are merged here by type.
+struct Reactor::FanOut {
+    int fd = -1;
+    uint64_t serial = 0;
+    size_t remaining = 0;
+    bool is_array = false;
+    int64_t sum = 0;
+    int64_t count = 0;
+    std::string body;
+    std::string error;
+    std::string status;  // "+OK" from every part (FLUSHALL)
+    uint64_t lsn = 0;    // newest AOF record among the parts
+
+    void merge(const std::string& reply) {
+        if (reply.empty()) return;
+        if (reply[0] == '-') {
+            if (error.empty()) error = reply;
+        } else if (reply[0] == '+') {
+            status = reply;
+        } else if (reply[0] == ':') {
+            sum += std::stoll(reply.substr(1));
+        } else if (reply[0] == '*') {
+            is_array = true;
+            size_t eol = reply.find("\r\n");
+            count += std::stoll(reply.substr(1, eol - 1));
+            body.append(reply, eol + 2, std::string::npos);
+        }
+    }
+
+    std::string result() const {
+        if (!error.empty()) return error;
+        if (!status.empty()) return status;
+        if (is_array) return "*" + std::to_string(count) + "\r\n" + body;
+        return ":" + std::to_string(sum) + "\r\n";
+    }
+};
+
+Reactor::Reactor(const std::string& io_backend,
+                 mini_redis::StorageEngine& storage,
+                 mini_redis::concurrency::ThreadPool& pool)
+    : io_backend_(io_backend),
+      listen_fd_(-1),
+      storage_(storage),
+      pool_(pool) {}
+
+Reactor::~Reactor() {
+#if defined(MINI_REDIS_HAVE_IO_URING)
+    if (wake_fd_ >= 0) close(wake_fd_);
+#endif
+}
+
+bool Reactor::start(int listen_fd) {
+    listen_fd_ = listen_fd;
+
+    mini_redis::AOFWriter* aof = storage_.aof();
+    if (aof && aof->fsync_policy() == mini_redis::AofFsync::ALWAYS) {
+        aof_ = aof;
+        aof_->on_durable([this] { notify(); });
+    }
+
+    if (io_backend_ == "io_uring")
+        return start_uring();
+
+    loop_ = make_event_loop(io_backend_);
+    if (!loop_) {
+        std::cerr << "Unsupported io_backend: " << io_backend_ << "\n";
+        return false;
+    }
+    if (!loop_->open())
+        return false;
+    loop_->watch(listen_fd_, READABLE);
+    return true;
+}
+
+const char* Reactor::backend_name() const {
+    if (loop_)
+        return loop_->name();
+    return "io_uring";
+}
+
+void Reactor::pool_dispatch(int fd, Connection::Batch batch) {
+    auto it = pool_conns_.find(fd);
+    if (it == pool_conns_.end())
+        return;
+    PoolConn& pc = it->second;
+    if (!pc.busy) {
+        submit_batch(fd, pc, std::move(batch));
+        return;
+    }
+    pc.next.append(std::move(batch));
+}
+
+void Reactor::submit_batch(int fd, PoolConn& pc, Connection::Batch batch) {
+    pc.busy = true;
+    uint64_t serial = pc.serial;
+    mini_redis::StorageEngine* storage = &storage_;
+    // One task, one response buffer, one completion for the whole batch. Both
+    // buffers come from and return to this reactor's pool.
+    OutputBuffer response;
+    response.open(buffers_.acquire());
+    pool_.enqueue([this, fd, serial, batch = std::move(batch), storage,
+                   response = std::move(response)]() mutable {
+        ::protocol::ResponseWriter out(response);
+        uint64_t before = mini_redis::AOFWriter::thread_lsn();
+        batch.for_each([&](CommandArgs cmd) {
+            mini_redis::protocol::execute_command(*storage, cmd, out);
+        });
+        uint64_t lsn = mini_redis::AOFWriter::thread_lsn();
+        push_pending_response(fd, serial, std::move(response), batch.release(), lsn != before ? lsn : 0);
+    });
+}
+
+void Reactor::push_pending_response(int fd, uint64_t serial, OutputBuffer response, std::string spent,
+                                    uint64_t lsn) {
+    completions_.push({fd, serial, std::move(response), std::move(spent), lsn});
+    notify();
+}
+
+void Reactor::notify() {
+    // seq_cst pairs with the store(false) in run(): either run() sees the
+    // pushed item when it drains, or this exchange sees false and wakes it.
+    if (wake_pending_.exchange(true))
+        return;
+#if defined(MINI_REDIS_HAVE_IO_URING)
+    if (ring_) {
+        uint64_t one = 1;
+        ssize_t r = write(wake_fd_, &one, sizeof(one));
+        (void)r;
+        return;
+    }
+#endif
+    loop_->wakeup();
+}
+
+void Reactor::update_write_interest(int fd, Connection& conn) {
+    bool wants = conn.wants_write() && !is_held(fd);
+    bool has = write_interest_.count(fd) != 0;
+    if (wants == has)
+        return;
+    if (wants)
+        write_interest_.insert(fd);
+    else
+        write_interest_.erase(fd);
+    loop_->watch(fd, wants ? (READABLE | WRITABLE) : READABLE);
+}
+
+void Reactor::deliver(int fd, OutputBuffer response, uint64_t lsn) {
+    auto it = connections_.find(fd);
+    if (it == connections_.end())
+        return;
+    it->second->add_pending_response(std::move(response));
+    hold(fd, lsn);
+    output_ready(fd, *it->second);
+}
+
+void Reactor::execute_inline(int fd, CommandArgs cmd) {
+    auto it = connections_.find(fd);
+    if (it == connections_.end())
+        return;
+    ::protocol::ResponseWriter out(it->second->output());
+    uint64_t before = mini_redis::AOFWriter::thread_lsn();
+    mini_redis::protocol::execute_command(storage_, cmd, out);
+    uint64_t lsn = mini_redis::AOFWriter::thread_lsn();
+    if (lsn != before)
+        hold(fd, lsn);
+    output_ready(fd, *it->second);
+}
+
+// Replies queued behind a hold wait with it: the output goes out in order,
+// once the newest write queued to it is durable.
+void Reactor::hold(int fd, uint64_t lsn) {
+    if (!aof_ || lsn == 0 || lsn <= aof_->durable_lsn())
+        return;
+    uint64_t& until = held_[fd];
+    until = std::max(until, lsn);
+}
+
+void Reactor::release_held() {
+    if (held_.empty())
+        return;
+    uint64_t durable = aof_->durable_lsn();
+    for (auto it = held_.begin(); it != held_.end();) {
+        if (it->second > durable) {
+            ++it;
+            continue;
+        }
+        int fd = it->first;
+        it = held_.erase(it);
+        auto conn = connections_.find(fd);
+        if (conn != connections_.end())
+            output_ready(fd, *conn->second);
+    }
+}
+
+void Reactor::output_ready(int fd, Connection& conn) {
+    if (is_held(fd))
+        return;
+#if defined(MINI_REDIS_HAVE_IO_URING)
+    if (ring_) {
+        auto st = uring_conns_.find(fd);
+        if (st != uring_conns_.end())
+            uring_send(fd, st->second);
+        return;
+    }
+#endif
+    (void)conn;
+    flush_list_.push_back(fd);
+}
+
+void Reactor::flush_writes() {
+    // Optimistic write: most replies fit in the socket buffer, so send them
+    // now and only register write interest for what is left over.
+    for (int fd : flush_list_) {
+        auto it = connections_.find(fd);
+        if (it == connections_.end())
+            continue;
+        Connection& conn = *it->second;
+        if (conn.wants_write() && !conn.handle_write()) {
+            remove_connection(fd);
+            continue;
+        }
+        update_write_interest(fd, conn);
+    }
+    flush_list_.clear();
+}
+
+void Reactor::drain_response_queue() {
+    completions_.drain([this](Completion&& c) {
+        buffers_.release(std::move(c.spent));
+        auto it = pool_conns_.find(c.fd);
+        if (it == pool_conns_.end() || it->second.serial != c.serial)
+            return;  // client went away while the batch was running
+        PoolConn& pc = it->second;
+        deliver(c.fd, std::move(c.response), c.lsn);
+        pc.busy = false;
+        if (!pc.next.empty()) {
+            Connection::Batch next;
+            std::swap(next, pc.next);
+            submit_batch(c.fd, pc, std::move(next));
+        }
+    });
+}
+
+void Reactor::add_connection(int fd) {
+    Connection::SubmitFn submit_fn;
+    if (mesh_) {
+        mesh_conns_[fd].serial = ++next_serial_;
+        submit_fn = [this](int fd, Connection::Batch batch) {
+            mesh_dispatch(fd, std::move(batch));
+        };
+    } else {
+        pool_conns_[fd].serial = ++next_serial_;
+        submit_fn = [this](int fd, Connection::Batch batch) {
+            pool_dispatch(fd, std::move(batch));
+        };
+    }
+    connections_.emplace(fd, std::make_unique<Connection>(fd, std::move(submit_fn), buffers_));
+}
+
+void Reactor::remove_connection(int fd) {
+    if (loop_) {
+        write_interest_.erase(fd);
+        loop_->unwatch(fd);
+    }
+#if defined(MINI_REDIS_HAVE_IO_URING)
+    uring_conns_.erase(fd);
+#endif
+    pool_conns_.erase(fd);
+    mesh_conns_.erase(fd);
+    held_.erase(fd);
+    connections_.erase(fd);
+}
+
+void Reactor::join_mesh(size_t core, const std::vector<Reactor*>& peers) {
+    mesh_ = true;
+    core_ = core;
+    peers_ = peers;
+    inbox_.clear();
+    for (size_t i = 0; i < peers.size(); ++i)
+        inbox_.push_back(std::make_unique<mini_redis::concurrency::SpscQueue<CoreMessage*>>(
+            MESH_QUEUE_CAPACITY));
+    outbox_.assign(peers.size(), {});
+    peer_needs_notify_.assign(peers.size(), false);
+}
+
+void Reactor::mesh_dispatch(int fd, Connection::Batch batch) {
+    auto it = mesh_conns_.find(fd);
+    if (it == mesh_conns_.end())
+        return;
+    MeshConn& mc = it->second;
+    batch.for_each([&](CommandArgs cmd) {
+        if (mc.waiting)
+            mc.backlog.emplace_back(cmd.begin(), cmd.end());
+        else
+            mesh_route(fd, mc, cmd);
+    });
+    buffers_.release(batch.release());
+}
+
+void Reactor::mesh_route(int fd, MeshConn& mc, CommandArgs cmd) {
+    // Key positions come from the command table. Unknown commands and arity
+    // errors have no keys and fail inline.
+    const auto* spec = mini_redis::protocol::lookup_command(cmd[0]);
+    size_t first_key = 0, end_key = 0;  // key arguments are cmd[first_key, end_key)
+    bool all_cores = false;
+    if (spec && spec->arity_ok(cmd.size())) {
+        first_key = spec->keys_begin();
+        end_key = std::min(spec->keys_end(cmd.size()), cmd.size());
+        all_cores = (spec->flags & mini_redis::protocol::CMD_ALL_SHARDS) && peers_.size() > 1;
+    }
+
+    const size_t split = peers_.size();
+    size_t owner = all_cores ? split : core_;
+    uint64_t cursor = 0;
+    if (spec && (spec->flags & mini_redis::protocol::CMD_CURSOR) && cmd.size() > 1 &&
+        std::from_chars(cmd[1].data(), cmd[1].data() + cmd[1].size(), cursor).ec == std::errc())
+        owner = storage_.scan_owner_core(cursor);
+    for (size_t i = first_key; i < end_key; ++i) {
+        size_t c = storage_.owner_core(cmd[i]);
+        if (i == first_key) {
+            owner = c;
+        } else if (c != owner) {
+            owner = split;
+            break;
+        }
+    }
+
+    // Hot path: keyless, or every key owned here. No locks, no atomics.
+    if (owner == core_) {
+        execute_inline(fd, cmd);
+        return;
+    }
+
+    mc.waiting = true;
+
+    if (owner != split) {
+        auto* msg = new CoreMessage;
+        msg->origin = core_;
+        msg->fd = fd;
+        msg->serial = mc.serial;
+        msg->cmd.assign(cmd.begin(), cmd.end());
+        mesh_post(owner, msg);
+        return;
+    }
+
+    // Split per owning core.
+    std::vector<std::vector<std::string>> parts(peers_.size());
+    if (all_cores) {
+        for (auto& part : parts)
+            part.assign(cmd.begin(), cmd.end());
+    } else {
+        // Multi-key commands: the arguments before the keys, then the keys
+        // this core owns.
+        for (size_t i = first_key; i < end_key; ++i) {
+            std::string key(cmd[i]);
+            auto& part = parts[storage_.owner_core(key)];
+            if (part.empty())
+                part.assign(cmd.begin(), cmd.begin() + static_cast<std::ptrdiff_t>(first_key));
+            part.push_back(std::move(key));
+        }
+    }
+
+    auto* fan = new FanOut;
+    fan->fd = fd;
+    fan->serial = mc.serial;
+    for (const auto& part : parts)
+        if (!part.empty())
+            ++fan->remaining;
+
+    for (size_t c = 0; c < parts.size(); ++c) {
+        if (parts[c].empty())
+            continue;
+        if (c == core_) {
+            std::string reply;
+            ::protocol::ResponseWriter out(reply);
+            uint64_t before = mini_redis::AOFWriter::thread_lsn();
+            mini_redis::protocol::execute_command(storage_, views_of(parts[c]), out);
+            if (mini_redis::AOFWriter::thread_lsn() != before)
+                fan->lsn = mini_redis::AOFWriter::thread_lsn();
+            fan->merge(reply);
+            --fan->remaining;
+            continue;
+        }
+        auto* msg = new CoreMessage;
+        msg->origin = core_;
+        msg->fd = fd;
+        msg->serial = mc.serial;
+        msg->cmd = std::move(parts[c]);
+        msg->fan = fan;
+        mesh_post(c, msg);
+    }
+
+    if (fan->remaining == 0) {
+        std::string reply = fan->result();
+        uint64_t lsn = fan->lsn;
+        delete fan;
+        mesh_finish(fd, mc.serial, reply_of(std::move(reply)), lsn);
+    }
+}
+
+void Reactor::mesh_post(size_t core, CoreMessage* msg) {
+    // Keep per-destination FIFO order: never overtake queued overflow.
+    if (!outbox_[core].empty() || !peers_[core]->inbox_[core_]->push(msg))
+        outbox_[core].push_back(msg);
+    peer_needs_notify_[core] = true;
+}
+
+void Reactor::mesh_notify_peers() {
+    // One wakeup per peer per iteration, however many messages we sent it.
+    for (size_t c = 0; c < peer_needs_notify_.size(); ++c) {
+        if (peer_needs_notify_[c]) {
+            peer_needs_notify_[c] = false;
+            peers_[c]->notify();
+        }
+    }
+}
+
+void Reactor::mesh_finish(int fd, uint64_t serial, OutputBuffer reply, uint64_t lsn) {
+    auto it = mesh_conns_.find(fd);
+    if (it == mesh_conns_.end() || it->second.serial != serial)
+        return;  // client went away while the command was in flight
+    MeshConn& mc = it->second;
+    deliver(fd, std::move(reply), lsn);
+    mc.waiting = false;
+    while (!mc.waiting && !mc.backlog.empty()) {
+        std::vector<std::string> cmd = std::move(mc.backlog.front());
+        mc.backlog.pop_front();
+        mesh_route(fd, mc, views_of(cmd));
+    }
+}
+
+// Run this core's share of active expiry when it is due; returns the wait
+// timeout that wakes the loop for the next cycle.
+int Reactor::mesh_expire() {
+    using namespace std::chrono;
+    auto now = steady_clock::now();
+    if (now >= next_expire_)
+        next_expire_ = now + milliseconds(storage_.expiry().run_cycle());
+    return static_cast<int>(ceil<milliseconds>(next_expire_ - now).count());
+}
+
+bool Reactor::mesh_poll() {
+    bool backlogged = false;
+
+    for (size_t c = 0; c < outbox_.size(); ++c) {
+        auto& pending = outbox_[c];
+        size_t sent = 0;
+        while (sent < pending.size() && peers_[c]->inbox_[core_]->push(pending[sent]))
+            ++sent;
+        pending.erase(pending.begin(), pending.begin() + static_cast<std::ptrdiff_t>(sent));
+        if (sent > 0)
+            peer_needs_notify_[c] = true;
+        backlogged = backlogged || !pending.empty();
+    }
+
+    for (size_t c = 0; c < inbox_.size(); ++c) {
+        CoreMessage* msg = nullptr;
+        while (inbox_[c]->pop(msg)) {
+            if (!msg->is_reply) {
+                // We own every key in msg->cmd: run it and send the reply home.
+                uint64_t before = mini_redis::AOFWriter::thread_lsn();
+                if (msg->fan) {
+                    ::protocol::ResponseWriter out(msg->result);
+                    mini_redis::protocol::execute_command(storage_, views_of(msg->cmd), out);
+                } else {
+                    ::protocol::ResponseWriter out(msg->reply);
+                    mini_redis::protocol::execute_command(storage_, views_of(msg->cmd), out);
+                }
+                if (mini_redis::AOFWriter::thread_lsn() != before)
+                    msg->lsn = mini_redis::AOFWriter::thread_lsn();
+                msg->is_reply = true;
+                mesh_post(msg->origin, msg);
+                continue;
+            }
+            if (FanOut* fan = msg->fan) {
+                fan->merge(msg->result);
+                fan->lsn = std::max(fan->lsn, msg->lsn);
+                if (--fan->remaining == 0) {
+                    mesh_finish(fan->fd, fan->serial, reply_of(fan->result()), fan->lsn);
+                    delete fan;
+                }
+            } else {
+                mesh_finish(msg->fd, msg->serial, std::move(msg->reply), msg->lsn);
+            }
+            delete msg;
+        }
+    }
+    return backlogged;
+}
+
+void Reactor::accept_clients() {
+    while (true) {
+        int client_fd = accept_nonblocking(listen_fd_);
+        if (client_fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                perror("accept");
+            return;
+        }
+
+        add_connection(client_fd);
+        loop_->watch(client_fd, READABLE);
+    }
+}
+
+void Reactor::run() {
+    if (mesh_)
+        mini_redis::StorageEngine::bind_core(core_);
+
+    if (io_backend_ == "io_uring") {
+        run_uring();
+        return;
+    }
+
+    std::vector<IoEvent> events;
+    events.reserve(MAX_EVENTS);
+    std::vector<int> dead;
+
+    while (true) {
+        int timeout = -1;
+        wake_pending_.store(false);
+        drain_response_queue();
+        release_held();
+        if (mesh_) {
+            timeout = mesh_expire();
+            if (mesh_poll())
+                timeout = MESH_BACKOFF_MS;
+            mesh_notify_peers();
+        }
+        flush_writes();
+
+        int n = loop_->wait(events, timeout);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror(loop_->name());
+            continue;
+        }
+
+        dead.clear();
+
+        for (const IoEvent& ev : events) {
+            int fd = ev.fd;
+            if (fd == listen_fd_) {
+                accept_clients();
+                continue;
+            }
+
+            auto it = connections_.find(fd);
+            if (it == connections_.end()) continue;
+
+            Connection* conn = it->second.get();
+            bool alive = true;
+
+            if (ev.mask & READABLE)
+                alive = conn->handle_read();
+            // Also covers replies produced inline by the read (mesh mode).
+            if (alive && ((ev.mask & WRITABLE) || conn->wants_write()) && !is_held(fd))
+                alive = conn->handle_write();
+
+            if (!alive)
+                dead.push_back(fd);
+            else
+                update_write_interest(fd, *conn);
+        }
+
+        for (int fd : dead)
+            remove_connection(fd);
+    }
+}
+
+#if defined(MINI_REDIS_HAVE_IO_URING)
+
+// io_uring path: one multishot accept, one multishot recv per connection
+// drawing from a shared provided-buffer ring, and at most one send in flight
+// per connection. Everything queued during an iteration is submitted by the
+// single io_uring_enter that also waits for the next completions. Should the
+// SQ still be full (get_sqe() returns null, e.g. the kernel refusing
+// submissions with EBUSY while the CQ overflows), the arm or send is put
+// aside and retried on the next iteration.
+
+namespace {
+
+constexpr unsigned URING_SQ_ENTRIES = 1024;
+constexpr unsigned URING_CQ_ENTRIES = 8192;
+constexpr unsigned RECV_BUFFER_COUNT = 1024;  // power of two
+constexpr unsigned RECV_BUFFER_SIZE = 8192;
+constexpr uint16_t RECV_BUFFER_GROUP = 0;
+
+enum UringOp : uint64_t {
+    OP_ACCEPT = 1,
+    OP_RECV = 2,
+    OP_SEND = 3,
+    OP_WAKE = 4,
+};
+
+uint64_t pack(UringOp op, int fd) {
+    return (static_cast<uint64_t>(op) << 32) | static_cast<uint32_t>(fd);
+}
+
+} // namespace
+
+bool Reactor::start_uring() {
+    ring_ = std::make_unique<Uring>();
+    if (!ring_->init(URING_SQ_ENTRIES, URING_CQ_ENTRIES)) {
+        perror("io_uring_setup");
+        return false;
+    }
+    recv_buffers_ = std::make_unique<BufferRing>();
+    if (!recv_buffers_->init(*ring_, RECV_BUFFER_GROUP, RECV_BUFFER_COUNT, RECV_BUFFER_SIZE)) {
+        perror("io_uring provided buffers");
+        return false;
+    }
+    wake_fd_ = eventfd(0, EFD_CLOEXEC);
+    if (wake_fd_ < 0) {
+        perror("eventfd");
+        return false;
+    }
+    return true;
+}
+
+void Reactor::uring_arm_wake() {
+    io_uring_sqe* sqe = ring_->get_sqe();
+    uring_wake_deferred_ = sqe == nullptr;
+    if (!sqe)
+        return;
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = wake_fd_;
+    sqe->addr = reinterpret_cast<uint64_t>(&wake_buf_);
+    sqe->len = sizeof(wake_buf_);
+    sqe->user_data = pack(OP_WAKE, wake_fd_);
+}
+
+void Reactor::uring_arm_accept() {
+    io_uring_sqe* sqe = ring_->get_sqe();
+    uring_accept_deferred_ = sqe == nullptr;
+    if (!sqe)
+        return;
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = listen_fd_;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    sqe->user_data = pack(OP_ACCEPT, listen_fd_);
+}
+
+void Reactor::uring_arm_recv(int fd, UringConn& st) {
+    io_uring_sqe* sqe = ring_->get_sqe();
+    if (!sqe) {
+        uring_rearm_.push_back(fd);
+        return;
+    }
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = recv_buffers_->group_id();
+    sqe->user_data = pack(OP_RECV, fd);
+    st.recv_armed = true;
+}
+
+void Reactor::uring_send(int fd, UringConn& st) {
+    if (st.sending || st.closing)
+        return;
+    if (st.inflight.empty() && (is_held(fd) || !connections_[fd]->take_output(st.inflight)))
+        return;
+    // One SENDMSG gathers the in-flight chunks; new replies queue up in the
+    // connection meanwhile and go out with the next one.
+    io_uring_sqe* sqe = ring_->get_sqe();
+    if (!sqe) {
+        uring_resend_.push_back(fd);  // st.inflight keeps the bytes
+        return;
+    }
+    st.msg = {};
+    st.msg.msg_iov = st.iov;
+    st.msg.msg_iovlen = st.inflight.gather(st.iov, UringConn::SEND_IOVS);
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(&st.msg);
+    sqe->len = 1;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = pack(OP_SEND, fd);
+    st.sending = true;
+}
+
+void Reactor::uring_close(int fd, UringConn& st) {
+    if (!st.closing) {
+        st.closing = true;
+        // Terminates the multishot recv; its final CQE finishes the close.
+        if (st.recv_armed)
+            shutdown(fd, SHUT_RDWR);
+    }
+    // The fd (and its number) stays reserved until no CQE can reference it.
+    if (!st.recv_armed && !st.sending)
+        uring_dead_.push_back(fd);
+}
+
+void Reactor::uring_complete(const io_uring_cqe& cqe) {
+    auto op = static_cast<UringOp>(cqe.user_data >> 32);
+    int fd = static_cast<int>(cqe.user_data & 0xffffffffu);
+    bool more = (cqe.flags & IORING_CQE_F_MORE) != 0;
+
+    if (op == OP_WAKE) {
+        uring_arm_wake();
+        return;
+    }
+
+    if (op == OP_ACCEPT) {
+        if (cqe.res >= 0) {
+            add_connection(cqe.res);
+            UringConn& st = uring_conns_[cqe.res];
+            st.inflight = OutputBuffer(&buffers_);
+            uring_arm_recv(cqe.res, st);
+        } else if (cqe.res != -EINTR && cqe.res != -ECONNABORTED) {
+            errno = -cqe.res;
+            perror("accept");
+        }
+        if (!more)
+            uring_arm_accept();
+        return;
+    }
+
+    auto it = uring_conns_.find(fd);
+    if (it == uring_conns_.end())
+        return;
+    UringConn& st = it->second;
+
+    if (op == OP_RECV) {
+        if (cqe.res > 0) {
+            uint16_t bid = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+            bool ok = st.closing ||
+                      connections_[fd]->on_data(recv_buffers_->buffer(bid), static_cast<size_t>(cqe.res));
+            recv_buffers_->recycle(bid);
+            if (!ok)
+                uring_close(fd, st);
+        }
+        if (more)
+            return;
+        st.recv_armed = false;
+        if (cqe.res == -ENOBUFS && !st.closing) {
+            // Ring ran dry; re-arm once this batch's buffers are returned.
+            uring_rearm_.push_back(fd);
+        } else if (cqe.res > 0 && !st.closing) {
+            uring_arm_recv(fd, st);
+        } else {
+            uring_close(fd, st);
+        }
+        return;
+    }
+
+    if (op == OP_SEND) {
+        st.sending = false;
+        if (cqe.res < 0) {
+            uring_close(fd, st);
+            return;
+        }
+        st.inflight.consume(static_cast<size_t>(cqe.res));
+        if (st.closing)
+            uring_close(fd, st);
+        else
+            uring_send(fd, st);
+    }
+}
+
+bool Reactor::uring_retry_deferred() {
+    if (uring_wake_deferred_)
+        uring_arm_wake();
+    if (uring_accept_deferred_)
+        uring_arm_accept();
+    // Swapped out first: a retry that still finds no SQE queues itself again.
+    std::vector<int> fds;
+    fds.swap(uring_rearm_);
+    for (int fd : fds) {
+        auto it = uring_conns_.find(fd);
+        // The fd may since have closed, or been reused by an armed connection.
+        if (it != uring_conns_.end() && !it->second.closing && !it->second.recv_armed)
+            uring_arm_recv(fd, it->second);
+    }
+    fds.clear();
+    fds.swap(uring_resend_);
+    for (int fd : fds) {
+        auto it = uring_conns_.find(fd);
+        if (it != uring_conns_.end())
+            uring_send(fd, it->second);
+    }
+    return uring_wake_deferred_ || uring_accept_deferred_ || !uring_rearm_.empty() ||
+           !uring_resend_.empty();
+}
+
+void Reactor::run_uring() {
+    uring_arm_wake();
+    uring_arm_accept();
+
+    while (true) {
+        int timeout = -1;
+        wake_pending_.store(false);
+        drain_response_queue();
+        release_held();
+        if (mesh_) {
+            timeout = mesh_expire();
+            if (mesh_poll())
+                timeout = MESH_BACKOFF_MS;
+            mesh_notify_peers();
+        }
+
+        // Still waiting on SQ space: poll, so they are retried promptly.
+        if (uring_retry_deferred())
+            timeout = 0;
+
+        int ret = ring_->submit_and_wait(1, timeout);
+        if (ret < 0 && ret != -EINTR && ret != -EBUSY && ret != -ETIME) {
+            errno = -ret;
+            perror("io_uring_enter");
+        }
+
+        ring_->drain_completions([this](const io_uring_cqe& cqe) { uring_complete(cqe); });
+        recv_buffers_->publish();
+
+        for (int fd : uring_dead_)
+            remove_connection(fd);
+        uring_dead_.clear();
+    }
+}
+
+#else
+
+bool Reactor::start_uring() {
+    std::cerr << "io_uring backend is not available on this platform\n";
+    return false;
+}
+
+void Reactor::run_uring() {}
+
+#endif
+
+} // namespace net
@@ -0,0 +1,79 @@
+#include "net/socket.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include <cstdio>
+
+namespace net {
+
+void set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags >= 0)
+        fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+int open_listener(int port, bool reuse_port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+
+    int opt = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    if (reuse_port && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
+        perror("setsockopt SO_REUSEPORT");
+        close(fd);
+        return -1;
+    }
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = INADDR_ANY;
+
+    if (bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        perror("bind");
+        close(fd);
+        return -1;
+    }
+
+    if (listen(fd, 1024) < 0) {
+        perror("listen");
+        close(fd);
+        return -1;
+    }
+
+    // Edge-triggered accept loops drain the backlog until EAGAIN.
+    set_nonblocking(fd);
+    return fd;
+}
+
+int accept_nonblocking(int listen_fd) {
+    sockaddr_in client{};
+    socklen_t len = sizeof(client);
+#if defined(__linux__)
+    return accept4(listen_fd, (sockaddr*)&client, &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+    int fd = accept(listen_fd, (sockaddr*)&client, &len);
+    if (fd >= 0)
+        set_nonblocking(fd);
+    return fd;
+#endif
+}
+
+ssize_t send_iov(int fd, const iovec* iov, size_t count) {
+#if defined(MSG_NOSIGNAL)
+    msghdr msg{};
+    msg.msg_iov = const_cast<iovec*>(iov);
+    msg.msg_iovlen = count;
+    return sendmsg(fd, &msg, MSG_NOSIGNAL);
+#else
+    return writev(fd, iov, static_cast<int>(count));
+#endif
+}
+
+} // namespace net
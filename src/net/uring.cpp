@@ -0,0 +1,187 @@
+#include "net/uring.hpp"
+
+#if defined(MINI_REDIS_HAVE_IO_URING)
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+
+namespace net {
+
+namespace {
+
+int sys_setup(unsigned entries, io_uring_params* p) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, p));
+}
+
+int sys_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags,
+              void* arg = nullptr, size_t arg_size = 0) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete,
+                                    flags, arg, arg_size));
+}
+
+int sys_register(int fd, unsigned op, void* arg, unsigned nr) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, op, arg, nr));
+}
+
+template <typename T>
+T* at(void* base, uint32_t off) {
+    return reinterpret_cast<T*>(static_cast<char*>(base) + off);
+}
+
+} // namespace
+
+Uring::~Uring() {
+    if (sqes_) munmap(sqes_, sqes_len_);
+    if (cq_ptr_ && cq_ptr_ != sq_ptr_) munmap(cq_ptr_, cq_len_);
+    if (sq_ptr_) munmap(sq_ptr_, sq_len_);
+    if (ring_fd_ >= 0) close(ring_fd_);
+}
+
+bool Uring::init(unsigned sq_entries, unsigned cq_entries) {
+    io_uring_params p{};
+    p.flags = IORING_SETUP_CQSIZE | IORING_SETUP_COOP_TASKRUN;
+    p.cq_entries = cq_entries;
+    ring_fd_ = sys_setup(sq_entries, &p);
+    if (ring_fd_ < 0 && errno == EINVAL) {
+        // Pre-5.19 kernels reject COOP_TASKRUN; it is only a hint.
+        p = io_uring_params{};
+        p.flags = IORING_SETUP_CQSIZE;
+        p.cq_entries = cq_entries;
+        ring_fd_ = sys_setup(sq_entries, &p);
+    }
+    if (ring_fd_ < 0)
+        return false;
+
+    sq_len_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cq_len_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap)
+        sq_len_ = cq_len_ = std::max(sq_len_, cq_len_);
+
+    sq_ptr_ = mmap(nullptr, sq_len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   ring_fd_, IORING_OFF_SQ_RING);
+    if (sq_ptr_ == MAP_FAILED) {
+        sq_ptr_ = nullptr;
+        return false;
+    }
+    if (single_mmap) {
+        cq_ptr_ = sq_ptr_;
+    } else {
+        cq_ptr_ = mmap(nullptr, cq_len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                       ring_fd_, IORING_OFF_CQ_RING);
+        if (cq_ptr_ == MAP_FAILED) {
+            cq_ptr_ = nullptr;
+            return false;
+        }
+    }
+
+    sqes_len_ = p.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = mmap(nullptr, sqes_len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring_fd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED)
+        return false;
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    sq_head_ = at<unsigned>(sq_ptr_, p.sq_off.head);
+    sq_tail_ = at<unsigned>(sq_ptr_, p.sq_off.tail);
+    sq_mask_ = at<unsigned>(sq_ptr_, p.sq_off.ring_mask);
+    sq_array_ = at<unsigned>(sq_ptr_, p.sq_off.array);
+    sq_entries_ = p.sq_entries;
+    sq_local_tail_ = *sq_tail_;
+
+    cq_head_ = at<unsigned>(cq_ptr_, p.cq_off.head);
+    cq_tail_ = at<unsigned>(cq_ptr_, p.cq_off.tail);
+    cq_mask_ = at<unsigned>(cq_ptr_, p.cq_off.ring_mask);
+    cqes_ = at<io_uring_cqe>(cq_ptr_, p.cq_off.cqes);
+    return true;
+}
+
+io_uring_sqe* Uring::get_sqe() {
+    unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    if (sq_local_tail_ - head >= sq_entries_) {
+        submit_and_wait(0);
+        head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+        if (sq_local_tail_ - head >= sq_entries_)
+            return nullptr;
+    }
+    unsigned idx = sq_local_tail_ & *sq_mask_;
+    io_uring_sqe* sqe = &sqes_[idx];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sq_array_[idx] = idx;
+    ++sq_local_tail_;
+    ++to_submit_;
+    return sqe;
+}
+
+int Uring::submit_and_wait(unsigned wait_nr, int timeout_ms) {
+    __atomic_store_n(sq_tail_, sq_local_tail_, __ATOMIC_RELEASE);
+    unsigned flags = wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0;
+    int ret;
+    if (wait_nr > 0 && timeout_ms >= 0) {
+        __kernel_timespec ts{};
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = static_cast<long long>(timeout_ms % 1000) * 1000000LL;
+        io_uring_getevents_arg arg{};
+        arg.ts = reinterpret_cast<uint64_t>(&ts);
+        ret = sys_enter(ring_fd_, to_submit_, wait_nr, flags | IORING_ENTER_EXT_ARG,
+                        &arg, sizeof(arg));
+    } else {
+        ret = sys_enter(ring_fd_, to_submit_, wait_nr, flags);
+    }
+    if (ret < 0)
+        return -errno;
+    to_submit_ -= std::min(to_submit_, static_cast<unsigned>(ret));
+    return ret;
+}
+
+BufferRing::~BufferRing() {
+    if (bufs_) munmap(bufs_, ring_len_);
+}
+
+bool BufferRing::init(Uring& ring, uint16_t group_id, unsigned count, unsigned buf_size) {
+    ring_len_ = count * sizeof(io_uring_buf);
+    void* mem = mmap(nullptr, ring_len_, PROT_READ | PROT_WRITE,
+                     MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (mem == MAP_FAILED)
+        return false;
+    // Indexed as a plain io_uring_buf array: in C++ the flexible array in
+    // io_uring_buf_ring does not start at offset 0 on every header version.
+    bufs_ = static_cast<io_uring_buf*>(mem);
+    count_ = count;
+    buf_size_ = buf_size;
+    group_id_ = group_id;
+    storage_.resize(size_t(count) * buf_size);
+
+    io_uring_buf_reg reg{};
+    reg.ring_addr = reinterpret_cast<uint64_t>(bufs_);
+    reg.ring_entries = count;
+    reg.bgid = group_id;
+    if (sys_register(ring.fd(), IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+        return false;
+
+    for (unsigned i = 0; i < count; ++i)
+        recycle(static_cast<uint16_t>(i));
+    publish();
+    return true;
+}
+
+void BufferRing::recycle(uint16_t bid) {
+    io_uring_buf* buf = &bufs_[tail_ & (count_ - 1)];
+    buf->addr = reinterpret_cast<uint64_t>(buffer(bid));
+    buf->len = buf_size_;
+    buf->bid = bid;
+    ++tail_;
+}
+
+void BufferRing::publish() {
+    // The ring tail overlays bufs[0].resv (see struct io_uring_buf_ring).
+    __atomic_store_n(&bufs_[0].resv, tail_, __ATOMIC_RELEASE);
+}
+
+} // namespace net
+
+#endif // MINI_REDIS_HAVE_IO_URING
@@ -1,49 +1,260 @@
 #include "persistence/aof_reader.hpp"
+#include "persistence/aof_format.hpp"
+#include "concurrency/thread_pool.hpp"
+#include "protocol/parser.hpp"
 #include "storage/storage_engine.hpp"
 
-#include <fstream>
-#include <sstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <span>
+#include <thread>
+#include <vector>
 
 namespace mini_redis {
 
+namespace {
+
+using Args = std::span<const std::string_view>;
+
+constexpr size_t MAX_LANES = 16;        // threads applying records
+constexpr size_t BATCH_OPS = 1 << 16;   // parsed ahead of the lanes
+
+bool parse_u64(std::string_view s, uint64_t& out) {
+    auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), out);
+    return ec == std::errc() && end == s.data() + s.size();
+}
+
+// One key's share of a record. Ops are applied by lanes that each own whole
+// shards, so a key's ops keep their file order; flushes are applied between
+// batches, once every lane has caught up.
+struct Op {
+    enum Kind : uint8_t { SET, SET_EXPIRE_AT, SET_TTL, DEL, EXPIRE_AT, EXPIRE } kind;
+    std::string_view key;
+    std::string_view value;
+    uint64_t ms = 0;  // absolute for *_AT, relative otherwise
+};
+
+void apply_op(StorageEngine& engine, const Op& op) {
+    switch (op.kind) {
+    case Op::SET: engine.set(op.key, op.value); break;
+    case Op::SET_EXPIRE_AT: engine.set_with_expire_at(op.key, op.value, op.ms); break;
+    case Op::SET_TTL: engine.set_with_ttl(op.key, op.value, op.ms); break;
+    case Op::DEL: engine.del(op.key); break;
+    case Op::EXPIRE_AT: engine.expire_at(op.key, op.ms); break;
+    case Op::EXPIRE: engine.expire(op.key, op.ms); break;
+    }
+}
+
+// FLUSHALL (older files) or FLUSHSHARD slot shards.
+struct Flush {
+    enum Kind : uint8_t { NONE, ALL, SLOT } kind = NONE;
+    uint64_t slot = 0;
+    uint64_t shards = 0;
+};
+
+// A record as AOFWriter logs it; anything else is skipped.
+Flush decode_record(Args a, std::vector<Op>& out) {
+    std::string_view cmd = a.empty() ? std::string_view() : a[0];
+    uint64_t ms = 0;
+    if (cmd == "SET" && a.size() == 3) {
+        out.push_back({Op::SET, a[1], a[2]});
+    } else if (cmd == "SET" && a.size() == 5 && a[3] == "PXAT" && parse_u64(a[4], ms)) {
+        out.push_back({Op::SET_EXPIRE_AT, a[1], a[2], ms});
+    } else if (cmd == "DEL") {
+        for (size_t i = 1; i < a.size(); ++i)
+            out.push_back({Op::DEL, a[i], {}});
+    } else if (cmd == "PEXPIREAT" && a.size() == 3 && parse_u64(a[2], ms)) {
+        out.push_back({Op::EXPIRE_AT, a[1], {}, ms});
+    }
+    Flush flush;
+    if (cmd == "FLUSHALL")
+        flush.kind = Flush::ALL;
+    else if (cmd == "FLUSHSHARD" && a.size() == 3 && parse_u64(a[1], flush.slot) &&
+             parse_u64(a[2], flush.shards))
+        flush.kind = Flush::SLOT;
+    return flush;
+}
+
+// Older files: one space-separated command per line, so keys and values
+// with whitespace never survived; replayed as they were read before.
+Flush decode_line(std::string_view line, std::vector<Op>& out) {
+    std::string_view w[5];
+    size_t words = 0;
+    for (size_t i = 0; words < 5;) {
+        i = line.find_first_not_of(" \t\r", i);
+        if (i == std::string_view::npos)
+            break;
+        size_t end = std::min(line.find_first_of(" \t\r", i), line.size());
+        w[words++] = line.substr(i, end - i);
+        i = end;
+    }
+    uint64_t n = 0;
+    if (w[0] == "SET" && words >= 3) {
+        if (words == 5 && w[3] == "PXAT" && parse_u64(w[4], n))
+            out.push_back({Op::SET_EXPIRE_AT, w[1], w[2], n});
+        else
+            out.push_back({Op::SET, w[1], w[2]});
+    } else if (w[0] == "SETEX" && words >= 4 && parse_u64(w[2], n)) {
+        out.push_back({Op::SET_TTL, w[1], w[3], n * 1000});  // relative seconds
+    } else if (w[0] == "DEL" && words >= 2) {
+        out.push_back({Op::DEL, w[1], {}});
+    } else if (w[0] == "PEXPIREAT" && words >= 3 && parse_u64(w[2], n)) {
+        out.push_back({Op::EXPIRE_AT, w[1], {}, n});
+    } else if (w[0] == "EXPIRE" && words >= 3 && parse_u64(w[2], n)) {
+        out.push_back({Op::EXPIRE, w[1], {}, n * 1000});  // relative seconds
+    }
+    Flush flush;
+    if (w[0] == "FLUSHALL")
+        flush.kind = Flush::ALL;
+    return flush;
+}
+
+// Whether an intact record starts anywhere after the first byte of `rest`:
+// if so, damage at its start is not just a crash cutting the file short.
+bool intact_record_after(std::string_view rest) {
+    protocol::RespParser parser;
+    for (size_t at = rest.find('*', 1); at != std::string_view::npos; at = rest.find('*', at + 1)) {
+        std::string_view from = rest.substr(at);
+        if (parser.parse(from) != protocol::RespParser::Status::COMPLETE) {
+            parser = protocol::RespParser();
+            continue;
+        }
+        size_t frame = parser.frame_size();
+        if (from.size() >= frame + aof::CHECKSUM_BYTES &&
+            aof::checksum_matches(from.substr(0, frame), from.substr(frame, aof::CHECKSUM_BYTES)))
+            return true;
+    }
+    return false;
+}
+
+} // namespace
+
 AOFReader::AOFReader(const std::string& filename)
     : filename_(filename) {}
 
-void AOFReader::replay(StorageEngine& engine) {
-    std::ifstream in(filename_);
-    if (!in.is_open()) {
-        return; // No AOF yet
+bool AOFReader::replay(StorageEngine& engine) {
+    int fd = open(filename_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno == ENOENT)
+            return true;  // no AOF yet
+        perror("open aof");
+        return false;
+    }
+    struct stat st{};
+    if (fstat(fd, &st) != 0) {
+        perror("fstat aof");
+        close(fd);
+        return false;
     }
+    size_t size = static_cast<size_t>(st.st_size);
+    if (size == 0) {
+        close(fd);
+        return true;
+    }
+    void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("mmap aof");
+        return false;
+    }
+    madvise(map, size, MADV_SEQUENTIAL);
 
-    std::string line;
-    while (std::getline(in, line)) {
-        std::istringstream iss(line);
-        std::string cmd;
-        iss >> cmd;
+    auto started = std::chrono::steady_clock::now();
+    std::string_view data(static_cast<const char*>(map), size);
 
-        if (cmd == "SET") {
-            std::string key, value;
-            iss >> key >> value;
-            engine.set(key, value);
-        }
-        else if (cmd == "SETEX") {
-            std::string key, value;
-            uint64_t ttl;
-            iss >> key >> ttl >> value;
-            engine.set_with_ttl(key, value, ttl);
+    // Parsing runs ahead on this thread; a batch's ops are then applied by
+    // the lanes at once. Ops point into the mapping, so nothing is copied.
+    size_t cores = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    concurrency::ThreadPool pool(std::min(cores, MAX_LANES) - 1);
+    std::vector<std::vector<Op>> lanes(pool.size() + 1);
+    size_t batched = 0;
+    auto apply_batch = [&] {
+        pool.parallel_for(lanes.size(), [&](size_t i) {
+            for (const Op& op : lanes[i])
+                apply_op(engine, op);
+            lanes[i].clear();
+        });
+        batched = 0;
+    };
+
+    protocol::RespParser parser;
+    std::vector<std::string_view> argv;
+    std::vector<Op> ops;
+    size_t pos = 0;
+    bool records_started = false;  // text lines only come before any record
+    while (pos < size) {
+        std::string_view rest = data.substr(pos);
+        Flush flush;
+        ops.clear();
+        if (rest[0] != '*') {
+            // A record whose '*' was damaged; its payload must not run as lines.
+            if (records_started)
+                break;
+            size_t nl = rest.find('\n');
+            if (nl == std::string_view::npos)
+                break;  // a line cut short
+            flush = decode_line(rest.substr(0, nl), ops);
+            pos += nl + 1;
+        } else {
+            if (parser.parse(rest) != protocol::RespParser::Status::COMPLETE)
+                break;
+            size_t frame = parser.frame_size();
+            size_t end = frame + aof::CHECKSUM_BYTES;
+            if (rest.size() < end || !aof::checksum_matches(rest.substr(0, frame),
+                                                            rest.substr(frame, aof::CHECKSUM_BYTES)))
+                break;
+            argv.clear();
+            for (const auto& a : parser.args())
+                argv.emplace_back(rest.data() + a.offset, a.length);
+            flush = decode_record(argv, ops);
+            pos += end;
+            records_started = true;
         }
-        else if (cmd == "DEL") {
-            std::string key;
-            iss >> key;
-            engine.del(key);
+        ++records_;
+        if (flush.kind != Flush::NONE) {
+            if (batched > 0)
+                apply_batch();
+            if (flush.kind == Flush::ALL)
+                engine.flush_all();
+            else
+                engine.flush_slot(flush.slot, flush.shards);
         }
-        else if (cmd == "EXPIRE") {
-            std::string key;
-            uint64_t ttl;
-            iss >> key >> ttl;
-            engine.expire(key, ttl);
+        for (const Op& op : ops)
+            lanes[engine.shard_of(op.key) % lanes.size()].push_back(op);
+        batched += ops.size();
+        if (batched >= BATCH_OPS)
+            apply_batch();
+    }
+    apply_batch();
+    bool damaged = pos < size && intact_record_after(data.substr(pos));
+    munmap(map, size);
+
+    if (damaged) {
+        std::cerr << "AOF " << filename_ << " is damaged at byte " << pos << " of " << size
+                  << " (" << records_ << " records replayed before it)\n";
+        return false;
+    }
+    if (pos < size) {
+        std::cerr << "AOF " << filename_ << ": dropping " << size - pos
+                  << " bytes of truncated record at the end\n";
+        if (truncate(filename_.c_str(), static_cast<off_t>(pos)) != 0) {
+            perror("truncate aof");
+            return false;
         }
     }
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - started).count();
+    std::cout << "AOF: replayed " << records_ << " records (" << pos << " bytes) in " << ms << " ms\n";
+    return true;
 }
 
 } // namespace mini_redis
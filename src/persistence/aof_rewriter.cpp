@@ -0,0 +1,198 @@
+#include "persistence/aof_rewriter.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <charconv>
+#include <cstdio>
+#include <iostream>
+
+#include "common/time.hpp"
+#include "persistence/aof_format.hpp"
+#include "persistence/aof_writer.hpp"
+
+namespace mini_redis {
+
+namespace {
+
+constexpr const char* TEMP_SUFFIX = ".rewrite";  // the new file, until renamed over the AOF
+constexpr size_t MAX_READY = 2;  // snapshots waiting to be written before cycles hold off
+constexpr size_t FLUSH_BYTES = 1024 * 1024;
+// Records logged during the rewrite are moved across until a round brings
+// fewer than this; the writer's thread appends the rest.
+constexpr size_t DRAIN_BYTES = 64 * 1024;
+constexpr size_t DRAIN_ROUNDS = 8;
+constexpr uint64_t AUTO_RETRY_MS = 10000;  // after a failed rewrite
+
+} // namespace
+
+AOFRewriter::AOFRewriter(AOFWriter& writer, std::string filename, size_t shards)
+    : writer_(writer), filename_(std::move(filename)), shards_(shards) {}
+
+AOFRewriter::~AOFRewriter() {
+    {
+        std::lock_guard lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    if (thread_.joinable())
+        thread_.join();
+}
+
+bool AOFRewriter::start() {
+    std::lock_guard lock(mutex_);
+    if (running_ || stopping_)
+        return false;
+    if (thread_.joinable())
+        thread_.join();  // the last rewrite's thread, done with mutex_
+    running_ = true;
+    thread_ = std::thread([this] { run(); });
+    return true;
+}
+
+bool AOFRewriter::in_progress() {
+    std::lock_guard lock(mutex_);
+    return running_;
+}
+
+void AOFRewriter::start_if_due() {
+    if (auto_percentage_ == 0)
+        return;
+    uint64_t size = writer_.file_bytes();
+    uint64_t base = writer_.base_bytes();
+    if (size < auto_min_bytes_ || size < base + base * auto_percentage_ / 100)
+        return;
+    uint64_t failed_at = failed_at_ms_.load(std::memory_order_relaxed);
+    if (failed_at != 0 && now_ms() - failed_at < AUTO_RETRY_MS)
+        return;
+    if (start())
+        std::cout << "AOF: " << size << " bytes, up from " << base << "; rewriting\n";
+}
+
+bool AOFRewriter::claim(size_t shard) {
+    std::lock_guard lock(mutex_);
+    if (!snapshotting_.load(std::memory_order_relaxed) || claimed_[shard] ||
+        ready_.size() >= MAX_READY)
+        return false;
+    claimed_[shard] = true;
+    return true;
+}
+
+void AOFRewriter::deliver(Shard::Snapshot snapshot) {
+    {
+        std::lock_guard lock(mutex_);
+        ready_.push_back(std::move(snapshot));
+    }
+    cv_.notify_all();
+}
+
+void AOFRewriter::run() {
+    uint64_t start = precise_now_ms();
+    bool ok = rewrite();
+    last_ok_ = ok;
+    if (ok) {
+        rewrites_.fetch_add(1, std::memory_order_relaxed);
+        failed_at_ms_ = 0;
+        std::cout << "AOF: rewritten to " << writer_.file_bytes() << " bytes in "
+                  << precise_now_ms() - start << " ms" << std::endl;
+    } else {
+        failed_at_ms_ = now_ms();
+    }
+    std::lock_guard lock(mutex_);
+    running_ = false;
+}
+
+bool AOFRewriter::rewrite() {
+    std::string path = filename_ + TEMP_SUFFIX;
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        perror("open aof rewrite");
+        return false;
+    }
+    if (!writer_.begin_rewrite()) {
+        close(fd);
+        unlink(path.c_str());
+        return false;
+    }
+
+    bool ok = write_snapshots(fd);
+    std::string buf;
+    for (size_t round = 0; ok && round < DRAIN_ROUNDS; ++round) {
+        writer_.take_rewritten(buf);
+        bool small = buf.size() < DRAIN_BYTES;
+        if (!aof::write_all(fd, buf)) {
+            perror("write aof rewrite");
+            ok = false;
+        }
+        buf.clear();
+        if (small)
+            break;
+    }
+    // Now, so the fsync in the swap has little left to do.
+    if (ok && !aof::sync_file(fd)) {
+        perror("fsync aof rewrite");
+        ok = false;
+    }
+    if (!ok) {
+        writer_.abort_rewrite();
+        close(fd);
+        unlink(path.c_str());
+        return false;
+    }
+    return writer_.finish_rewrite(fd, path);
+}
+
+bool AOFRewriter::write_snapshots(int fd) {
+    {
+        std::lock_guard lock(mutex_);
+        claimed_.assign(shards_, false);
+        ready_.clear();
+    }
+    snapshotting_ = true;
+
+    std::string buf;
+    char scratch[Value::INT_CHARS];
+    char expire_at[24];
+    bool ok = true;
+    for (size_t done = 0; ok && done < shards_; ++done) {
+        Shard::Snapshot snapshot;
+        {
+            std::unique_lock lock(mutex_);
+            cv_.wait(lock, [this] { return stopping_ || !ready_.empty(); });
+            if (stopping_)
+                break;
+            snapshot = std::move(ready_.front());
+            ready_.pop_front();
+        }
+        for (const auto& [key, value] : snapshot) {
+            std::string_view bytes = value.bytes(scratch);
+            if (value.expire_at == 0) {
+                aof::append_record(buf, {"SET", key, bytes});
+            } else {
+                char* end = std::to_chars(expire_at, expire_at + sizeof(expire_at), value.expire_at).ptr;
+                aof::append_record(buf, {"SET", key, bytes, "PXAT",
+                                         std::string_view(expire_at, static_cast<size_t>(end - expire_at))});
+            }
+            if (buf.size() >= FLUSH_BYTES) {
+                ok = aof::write_all(fd, buf);
+                buf.clear();
+                if (!ok)
+                    break;
+            }
+        }
+    }
+
+    snapshotting_ = false;
+    bool stopped;
+    {
+        std::lock_guard lock(mutex_);
+        ready_.clear();
+        stopped = stopping_;
+    }
+    ok = ok && !stopped && aof::write_all(fd, buf);
+    if (!ok && !stopped)
+        perror("write aof rewrite");
+    return ok;
+}
+
+} // namespace mini_redis
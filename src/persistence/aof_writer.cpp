@@ -1,44 +1,390 @@
 #include "persistence/aof_writer.hpp"
 
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+
+#include "common/memory_stats.hpp"
+#include "persistence/aof_format.hpp"
+
 namespace mini_redis {
 
-AOFWriter::AOFWriter(const std::string& filename, bool flush_on_each)
-    : file_(filename, std::ios::app), flush_on_each_(flush_on_each) {}
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr auto EVERYSEC_INTERVAL = std::chrono::seconds(1);
+constexpr auto RETRY_INTERVAL = std::chrono::milliseconds(100);  // after a failed write or fsync
+// A buffer grown past this by a burst is given back once drained.
+constexpr size_t SHRINK_BYTES = 4 * 1024 * 1024;
+
+std::atomic<uint64_t> next_writer_id{0};
+
+// The calling thread's stage in the writer it last appended to.
+thread_local uint64_t stage_writer = 0;
+thread_local void* stage_ptr = nullptr;
+thread_local uint64_t last_lsn = 0;
 
-void AOFWriter::maybe_flush() {
-    if (flush_on_each_)
-        file_.flush();
+std::string_view decimal(char (&buf)[24], uint64_t n) {
+    return {buf, static_cast<size_t>(std::to_chars(buf, buf + sizeof(buf), n).ptr - buf)};
 }
 
-void AOFWriter::append_set(
-    const std::string& key,
-    const std::string& value
-) {
-    std::lock_guard lock(mutex_);
-    file_ << "SET " << key << " " << value << "\n";
-    maybe_flush();
+// Makes a rename in the directory holding `path` durable.
+void sync_parent_dir(const std::string& path) {
+    size_t slash = path.rfind('/');
+    std::string dir = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    int fd = open(dir.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return;
+    fsync(fd);
+    close(fd);
 }
 
-void AOFWriter::append_setex(
-    const std::string& key,
-    uint64_t ttl,
-    const std::string& value
-) {
-    std::lock_guard lock(mutex_);
-    file_ << "SETEX " << key << " " << ttl << " " << value << "\n";
-    maybe_flush();
+} // namespace
+
+AOFWriter::AOFWriter(const std::string& filename, AofFsync policy)
+    : filename_(filename), policy_(policy), id_(++next_writer_id) {
+    fd_ = open(filename.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        perror("open aof");
+        return;
+    }
+    struct stat st;
+    if (fstat(fd_, &st) == 0) {
+        file_bytes_ = static_cast<uint64_t>(st.st_size);
+        base_bytes_ = static_cast<uint64_t>(st.st_size);
+    }
+    thread_ = std::thread([this] { run(); });
+}
+
+AOFWriter::~AOFWriter() {
+    if (thread_.joinable()) {
+        {
+            std::lock_guard lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_one();
+        thread_.join();
+    }
+    if (fd_ >= 0)
+        close(fd_);
+    memory_add(MemoryKind::AOF_BUFFER, -static_cast<int64_t>(accounted_));
 }
 
-void AOFWriter::append_del(const std::string& key) {
+uint64_t AOFWriter::thread_lsn() {
+    return last_lsn;
+}
+
+void AOFWriter::on_durable(std::function<void()> fn) {
     std::lock_guard lock(mutex_);
-    file_ << "DEL " << key << "\n";
-    maybe_flush();
+    listeners_.push_back(std::move(fn));
+}
+
+bool AOFWriter::begin_rewrite() {
+    std::unique_lock lock(mutex_);
+    if (rewrite_ != Rewrite::NONE || !thread_.joinable())
+        return false;
+    rewrite_ = Rewrite::REQUESTED;
+    cv_.notify_one();
+    rewrite_cv_.wait(lock, [this] { return rewrite_ != Rewrite::REQUESTED; });
+    return rewrite_ == Rewrite::CAPTURING;
 }
 
-void AOFWriter::append_expire(const std::string& key, uint64_t ttl_seconds) {
+void AOFWriter::take_rewritten(std::string& out) {
+    std::lock_guard lock(captured_mutex_);
+    if (out.empty()) {
+        out.swap(captured_);
+    } else {
+        out += captured_;
+        captured_.clear();
+    }
+}
+
+bool AOFWriter::finish_rewrite(int fd, const std::string& path) {
+    std::unique_lock lock(mutex_);
+    rewrite_fd_ = fd;
+    rewrite_path_ = path;
+    rewrite_ = Rewrite::SWAP;
+    cv_.notify_one();
+    rewrite_cv_.wait(lock, [this] { return rewrite_ == Rewrite::NONE; });
+    return rewrite_ok_;
+}
+
+void AOFWriter::abort_rewrite() {
     std::lock_guard lock(mutex_);
-    file_ << "EXPIRE " << key << " " << ttl_seconds << "\n";
-    maybe_flush();
+    rewrite_ = Rewrite::NONE;
+    cv_.notify_one();  // to drop what was captured
+}
+
+AOFWriter::Stage& AOFWriter::stage() {
+    if (stage_writer != id_) {
+        auto s = std::make_unique<Stage>();
+        stage_ptr = s.get();
+        stage_writer = id_;
+        std::lock_guard lock(mutex_);
+        stages_.push_back(std::move(s));
+    }
+    return *static_cast<Stage*>(stage_ptr);
+}
+
+void AOFWriter::append(std::initializer_list<std::string_view> args) {
+    Stage& s = stage();
+    {
+        // The LSN is taken under the stage lock, so once the writer has
+        // locked a stage every smaller LSN from that thread is in it.
+        std::lock_guard lock(s.mutex);
+        uint64_t lsn = next_lsn_.fetch_add(1, std::memory_order_relaxed) + 1;
+        aof::append_record(s.bytes, args);
+        s.records.push_back({lsn, s.bytes.size()});
+        last_lsn = lsn;
+    }
+    if (!pending_.load(std::memory_order_relaxed) && !pending_.exchange(true)) {
+        std::lock_guard lock(mutex_);
+        cv_.notify_one();
+    }
+}
+
+void AOFWriter::append_set(std::string_view key, std::string_view value) {
+    append({"SET", key, value});
+}
+
+void AOFWriter::append_set_expire_at(
+    std::string_view key,
+    std::string_view value,
+    uint64_t expire_at_ms
+) {
+    char buf[24];
+    append({"SET", key, value, "PXAT", decimal(buf, expire_at_ms)});
+}
+
+void AOFWriter::append_del(std::string_view key) {
+    append({"DEL", key});
+}
+
+void AOFWriter::append_expire_at(std::string_view key, uint64_t expire_at_ms) {
+    char buf[24];
+    append({"PEXPIREAT", key, decimal(buf, expire_at_ms)});
+}
+
+void AOFWriter::append_flush_shard(size_t shard, size_t shards) {
+    char a[24], b[24];
+    append({"FLUSHSHARD", decimal(a, shard), decimal(b, shards)});
+}
+
+void AOFWriter::run() {
+    Clock::time_point last_sync = Clock::now();
+    uint64_t written_lsn = 0;
+    for (bool stopping = false; !stopping;) {
+        bool swap = false;
+        {
+            std::unique_lock lock(mutex_);
+            auto ready = [&] {
+                return stopping_ || pending_.load() || rewrite_ == Rewrite::REQUESTED ||
+                       (rewrite_ == Rewrite::SWAP && out_.empty()) ||
+                       (rewrite_ == Rewrite::NONE && capturing_);
+            };
+            if (!out_.empty() || (policy_ == AofFsync::ALWAYS && synced_lsn_ < written_lsn))
+                cv_.wait_for(lock, RETRY_INTERVAL, ready);
+            else if (policy_ == AofFsync::EVERYSEC && synced_lsn_ < written_lsn)
+                cv_.wait_until(lock, last_sync + EVERYSEC_INTERVAL, ready);
+            else
+                cv_.wait(lock, ready);
+            stopping = stopping_;
+            // Capture starts before this round merges anything, so it
+            // covers every record not yet merged. An aborted capture is
+            // dropped.
+            if (rewrite_ == Rewrite::REQUESTED || (rewrite_ == Rewrite::NONE && capturing_)) {
+                {
+                    std::lock_guard captured(captured_mutex_);
+                    std::string().swap(captured_);
+                }
+                capturing_ = rewrite_ == Rewrite::REQUESTED;
+                if (capturing_) {
+                    rewrite_ = Rewrite::CAPTURING;
+                    rewrite_cv_.notify_all();
+                }
+            }
+            swap = rewrite_ == Rewrite::SWAP;
+        }
+        pending_.store(false);
+        gather();
+        if (write_out())
+            written_lsn = out_lsn_;
+
+        // Every record merged so far is in the old file and in captured_,
+        // so the new file, once given the rest, holds them all.
+        if (swap && out_.empty()) {
+            bool ok = swap_file();
+            if (ok && synced_lsn_ < written_lsn)
+                synced_lsn_ = written_lsn;  // the new file is fsynced whole
+            std::lock_guard lock(mutex_);
+            rewrite_ok_ = ok;
+            rewrite_ = Rewrite::NONE;
+            rewrite_cv_.notify_all();
+        }
+        account();
+
+        bool due = stopping || policy_ == AofFsync::ALWAYS ||
+                   (policy_ == AofFsync::EVERYSEC && Clock::now() - last_sync >= EVERYSEC_INTERVAL);
+        if (due && synced_lsn_ < written_lsn) {
+            if (aof::sync_file(fd_)) {
+                synced_lsn_ = written_lsn;
+                fsyncs_.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                perror("fsync aof");
+            }
+            last_sync = Clock::now();
+        }
+
+        uint64_t durable = policy_ == AofFsync::ALWAYS ? synced_lsn_ : written_lsn;
+        if (durable != durable_lsn_.load(std::memory_order_relaxed)) {
+            durable_lsn_.store(durable, std::memory_order_release);
+            std::lock_guard lock(mutex_);
+            for (const auto& fn : listeners_)
+                fn();
+        }
+    }
+}
+
+// Takes every stage's records and merges them onto out_ in LSN order, up to
+// the first gap: an LSN still being appended on a stage already passed.
+// What follows a gap stays in taken_ for the next round.
+void AOFWriter::gather() {
+    std::vector<Stage*> stages;
+    {
+        std::lock_guard lock(mutex_);
+        for (const auto& s : stages_)
+            stages.push_back(s.get());
+    }
+    taken_.resize(stages.size());
+
+    size_t held = 0;
+    for (size_t i = 0; i < stages.size(); ++i) {
+        Stage& s = *stages[i];
+        Taken& t = taken_[i];
+        std::lock_guard lock(s.mutex);
+        if (t.records.empty()) {
+            // Trade the drained buffers for the full ones.
+            t.bytes.clear();
+            t.bytes.swap(s.bytes);
+            t.records.swap(s.records);
+        } else {
+            size_t base = t.bytes.size();
+            t.bytes += s.bytes;
+            for (const Record& r : s.records)
+                t.records.push_back({r.lsn, base + r.end});
+            s.bytes.clear();
+            s.records.clear();
+        }
+        held += s.bytes.capacity() + s.records.capacity() * sizeof(Record);
+    }
+
+    size_t merged_from = out_.size();
+    uint64_t expect = out_lsn_ + 1;
+    for (bool progress = true; progress;) {
+        progress = false;
+        for (Taken& t : taken_) {
+            size_t first = t.next;
+            while (t.next < t.records.size() && t.records[t.next].lsn == expect) {
+                ++t.next;
+                ++expect;
+            }
+            if (t.next == first)
+                continue;
+            size_t begin = first == 0 ? 0 : t.records[first - 1].end;
+            out_.append(t.bytes, begin, t.records[t.next - 1].end - begin);
+            progress = true;
+        }
+    }
+    out_lsn_ = expect - 1;
+    if (capturing_) {
+        std::lock_guard lock(captured_mutex_);
+        captured_.append(out_, merged_from, std::string::npos);
+    }
+
+    for (Taken& t : taken_) {
+        if (t.next == t.records.size()) {
+            t.records.clear();
+            if (t.bytes.capacity() > SHRINK_BYTES)
+                std::string().swap(t.bytes);
+        } else if (t.next > 0) {
+            size_t cut = t.records[t.next - 1].end;
+            t.bytes.erase(0, cut);
+            t.records.erase(t.records.begin(), t.records.begin() + static_cast<std::ptrdiff_t>(t.next));
+            for (Record& r : t.records)
+                r.end -= cut;
+        }
+        t.next = 0;
+        held += t.bytes.capacity() + t.records.capacity() * sizeof(Record);
+    }
+
+    staged_bytes_ = held;
+}
+
+// Reports the buffers' size as AOF_BUFFER. After write_out() and any swap,
+// so a buffer they freed is not left counted while the server idles.
+void AOFWriter::account() {
+    size_t held = staged_bytes_ + out_.capacity();
+    {
+        std::lock_guard lock(captured_mutex_);
+        held += captured_.capacity();
+    }
+    memory_add(MemoryKind::AOF_BUFFER, static_cast<int64_t>(held) - static_cast<int64_t>(accounted_));
+    accounted_ = held;
+}
+
+// Writes out_ to the file; false (and out_ kept) on error.
+bool AOFWriter::write_out() {
+    if (out_.empty())
+        return true;
+    while (out_written_ < out_.size()) {
+        ssize_t n = ::write(fd_, out_.data() + out_written_, out_.size() - out_written_);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("write aof");
+            return false;
+        }
+        out_written_ += static_cast<size_t>(n);
+        file_bytes_.fetch_add(static_cast<uint64_t>(n), std::memory_order_relaxed);
+    }
+    writes_.fetch_add(1, std::memory_order_relaxed);
+    out_.clear();
+    out_written_ = 0;
+    if (out_.capacity() > SHRINK_BYTES)
+        std::string().swap(out_);
+    return true;
+}
+
+// Completes a rewrite: the records captured since it began go after the
+// snapshot in the new file, which then replaces the AOF.
+bool AOFWriter::swap_file() {
+    std::string rest;
+    {
+        std::lock_guard lock(captured_mutex_);
+        rest.swap(captured_);
+    }
+    capturing_ = false;
+    int fd = rewrite_fd_;
+    struct stat st;
+    if (!aof::write_all(fd, rest) || !aof::sync_file(fd) || fstat(fd, &st) != 0 ||
+        rename(rewrite_path_.c_str(), filename_.c_str()) != 0) {
+        perror("rewrite aof");
+        close(fd);
+        unlink(rewrite_path_.c_str());
+        return false;
+    }
+    sync_parent_dir(filename_);
+    close(fd_);
+    fd_ = fd;
+    file_bytes_ = static_cast<uint64_t>(st.st_size);
+    base_bytes_ = static_cast<uint64_t>(st.st_size);
+    return true;
 }
 
 } // namespace mini_redis
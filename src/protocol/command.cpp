@@ -0,0 +1,505 @@
+#include "protocol/command.hpp"
+#include "common/memory_stats.hpp"
+#include "protocol/response.hpp"
+#include "storage/storage_engine.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace mini_redis::protocol {
+
+namespace {
+
+using ::protocol::ResponseWriter;
+
+bool parse_u64(std::string_view s, uint64_t& out) {
+    auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), out);
+    return ec == std::errc() && end == s.data() + s.size();
+}
+
+bool iequals(std::string_view a, std::string_view upper) {
+    if (a.size() != upper.size())
+        return false;
+    for (size_t i = 0; i < a.size(); ++i)
+        if (std::toupper(static_cast<unsigned char>(a[i])) != upper[i])
+            return false;
+    return true;
+}
+
+constexpr std::string_view OOM_ERROR = "OOM command not allowed when used memory > 'maxmemory'";
+
+constexpr uint64_t SCAN_DEFAULT_COUNT = 10;
+constexpr uint64_t SCAN_MAX_COUNT = 100000;  // keeps one step's work bounded
+
+// Far enough out to mean "never" without overflowing now_ms() + ttl.
+constexpr uint64_t MAX_EXPIRE_MS = uint64_t{1} << 52;
+
+// A TTL or expiry time given in units of `unit_ms`, as milliseconds.
+bool parse_expire(std::string_view s, uint64_t unit_ms, uint64_t& out_ms) {
+    uint64_t n = 0;
+    if (!parse_u64(s, n) || n > MAX_EXPIRE_MS / unit_ms)
+        return false;
+    out_ms = n * unit_ms;
+    return true;
+}
+
+// ---- handlers: arity is checked before they run ----
+
+void cmd_ping(StorageEngine&, CommandArgs, ResponseWriter& out) {
+    out.raw(::protocol::PONG_REPLY);
+}
+
+void cmd_set(StorageEngine& storage, CommandArgs cmd, ResponseWriter& out) {
+    if (!storage.set(cmd[1], cmd[2])) {
+        out.error(OOM_ERROR);
+        return;
+    }
+    out.ok();
+}
+
+void cmd_get(StorageEngine& storage, CommandArgs cmd, ResponseWriter& out) {
+    // A reference to the stored value, not a copy of it.
+    Value value;
+    if (!storage.get(cmd[1], value)) {
+        out.null();
+        return;
+    }
+    out.bulk(value);
+}
+
+void cmd_setex(StorageEngine& storage, CommandArgs cmd, ResponseWriter& out) {
+    uint64_t ttl_ms = 0;
+    if (!parse_expire(cmd[2], 1000, ttl_ms)) {
+        out.error("invalid expire time");
+        return;
+    }
+    if (!storage.set_with_ttl(cmd[1], cmd[3], ttl_ms)) {
+        out.error(OOM_ERROR);
+        return;
+    }
+    out.ok();
+}
+
+void cmd_psetex(StorageEngine& storage, CommandArgs cmd, ResponseWriter& out) {
+    uint64_t ttl_ms = 0;
+    if (!parse_expire(cmd[2], 1, ttl_ms)) {
+        out.error("invalid expire time");
+        return;
+    }
+    if (!storage.set_with_ttl(cmd[1], cmd[3], ttl_ms)) {
+        out.error(OOM_ERROR);
+        return;
+    }
+    out.ok();
+}
+
+void cmd_del(StorageEngine& storage, CommandArgs cmd, ResponseWriter& out) {
+    int64_t removed = 0;
+    for (size_t i = 1; i < cmd.size(); ++i)
+        if (storage.del(cmd[i])) ++removed;
+    out.integer(removed);
+}
+
+void cmd_exists(StorageEngine& storage, CommandArgs cmd, ResponseWriter& out) {
+    int64_t count = 0;
+    for (size_t i = 1; i < cmd.size(); ++i)
+        if (storage.exists(cmd[i])) ++count;
+    out.integer(count);
+}
+
+void cmd_expire(StorageEngine& storage, CommandArgs cmd, ResponseWriter& out) {
+    uint64_t ttl_ms = 0;
+    if (!parse_expire(cmd[2], 1000, ttl_ms)) {
+        out.error("invalid expire time");
+        return;
+    }
+    out.integer(storage.expire(cmd[1], ttl_ms) ? 1 : 0);
+}
+
+void cmd_pexpire(StorageEngine& storage, CommandArgs cmd, ResponseWriter& out) {
+    uint64_t ttl_ms = 0;
+    if (!parse_expire(cmd[2], 1, ttl_ms)) {
+        out.error("invalid expire time");
+        return;
+    }
+    out.integer(storage.expire(cmd[1], ttl_ms) ? 1 : 0);
+}
+
+void cmd_pexpireat(StorageEngine& storage, CommandArgs cmd, ResponseWriter& out) {
+    uint64_t at_ms = 0;
+    if (!parse_expire(cmd[2], 1, at_ms)) {
+        out.error("invalid expire time");
+        return;
+    }
+    out.integer(storage.expire_at(cmd[1], at_ms) ? 1 : 0);
+}
+
+void cmd_ttl(StorageEngine& storage, CommandArgs cmd, ResponseWriter& out) {
+    out.integer(storage.ttl(cmd[1]));
+}
+
+void cmd_pttl(StorageEngine& storage, CommandArgs cmd, ResponseWriter& out) {
+    out.integer(storage.pttl(cmd[1]));
+}
+
+void cmd_keys(StorageEngine& storage, CommandArgs cmd, ResponseWriter& out) {
+    out.array(storage.keys(cmd[1]));
+}
+
+void cmd_dbsize(StorageEngine& storage, CommandArgs, ResponseWriter& out) {
+    out.integer(static_cast<int64_t>(storage.dbsize()));
+}
+
+void cmd_flushall(StorageEngine& storage, CommandArgs, ResponseWriter& out) {
+    storage.flush_all();
+    out.ok();
+}
+
+void cmd_bgrewriteaof(StorageEngine& storage, CommandArgs, ResponseWriter& out) {
+    if (!storage.aof()) {
+        out.error("AOF is disabled");
+        return;
+    }
+    if (!storage.rewrite_aof()) {
+        out.error("Background append only file rewriting already in progress");
+        return;
+    }
+    out.raw("+Background append only file rewriting started\r\n");
+}
+
+// SCAN cursor [MATCH pattern] [COUNT n]
+void cmd_scan(StorageEngine& storage, CommandArgs cmd, ResponseWriter& out) {
+    uint64_t cursor = 0;
+    if (!parse_u64(cmd[1], cursor)) {
+        out.error("invalid cursor");
+        return;
+    }
+    std::string_view pattern = "*";
+    uint64_t count = SCAN_DEFAULT_COUNT;
+    for (size_t i = 2; i < cmd.size(); i += 2) {
+        if (i + 1 == cmd.size()) {
+            out.error("syntax error");
+            return;
+        }
+        if (iequals(cmd[i], "MATCH")) {
+            pattern = cmd[i + 1];
+        } else if (iequals(cmd[i], "COUNT")) {
+            if (!parse_u64(cmd[i + 1], count) || count == 0) {
+                out.error("value is not an integer or out of range");
+                return;
+            }
+            count = std::min(count, SCAN_MAX_COUNT);
+        } else {
+            out.error("syntax error");
+            return;
+        }
+    }
+
+    std::vector<std::string> keys;
+    uint64_t next = storage.scan(cursor, static_cast<size_t>(count), pattern, keys);
+    char buf[24];
+    char* end = std::to_chars(buf, buf + sizeof(buf), next).ptr;
+    out.array_header(2);
+    out.bulk(std::string_view(buf, static_cast<size_t>(end - buf)));
+    out.array(keys);
+}
+
+// Memory totals across shards, plus buffers outside the keyspace.
+struct MemorySummary {
+    size_t dataset = 0;    // entries: nodes, keys and values
+    size_t hashtable = 0;  // slot and control arrays
+    size_t expires = 0;    // timing-wheel entries
+    size_t slab_reserved = 0;
+    size_t slab_used = 0;
+    size_t keys = 0;
+    size_t shard_min = SIZE_MAX;
+    size_t shard_max = 0;
+    size_t clients = memory_used(MemoryKind::CLIENT_BUFFERS);
+    size_t aof = memory_used(MemoryKind::AOF_BUFFER);
+
+    size_t overhead() const { return hashtable + expires + clients + aof; }
+    size_t total() const { return dataset + overhead(); }
+};
+
+size_t entry_bytes(const Shard::MemoryUsage& m) {
+    return m.map.nodes + m.map.keys + m.map.values;
+}
+
+MemorySummary summarize_memory(const StorageEngine& storage) {
+    MemorySummary sum;
+    for (size_t i = 0; i < storage.shard_count(); ++i) {
+        Shard::MemoryUsage m = storage.shard_memory(i);
+        sum.dataset += entry_bytes(m);
+        sum.hashtable += m.map.table;
+        sum.expires += m.expires;
+        sum.slab_reserved += m.slab_reserved;
+        sum.slab_used += m.slab_used;
+        sum.keys += storage.shard_keys(i);
+        sum.shard_min = std::min(sum.shard_min, m.total());
+        sum.shard_max = std::max(sum.shard_max, m.total());
+    }
+    return sum;
+}
+
+void info_field(std::string& info, std::string_view name, uint64_t value) {
+    info.append(name).append(":").append(std::to_string(value)).append("\r\n");
+}
+
+// Two decimals, for ratios.
+std::string ratio(double value) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.2f", value);
+    return buf;
+}
+
+void info_memory(const StorageEngine& storage, std::string& info) {
+    MemorySummary sum = summarize_memory(storage);
+    size_t shards = storage.shard_count();
+    size_t rss = resident_bytes();
+    info += "# Memory\r\n";
+    info_field(info, "used_memory", sum.total());
+    info_field(info, "used_memory_rss", rss);
+    info_field(info, "used_memory_dataset", sum.dataset);
+    info_field(info, "used_memory_overhead", sum.overhead());
+    info_field(info, "mem_hashtable", sum.hashtable);
+    info_field(info, "mem_expires", sum.expires);
+    info_field(info, "mem_clients_normal", sum.clients);
+    info_field(info, "mem_aof_buffer", sum.aof);
+    // Entry storage: slab bytes in use against live objects.
+    info_field(info, "allocator_allocated", sum.slab_used);
+    info_field(info, "allocator_active", sum.slab_reserved);
+    info.append("allocator_frag_ratio:")
+        .append(ratio(sum.slab_used ? static_cast<double>(sum.slab_reserved) / sum.slab_used : 1.0))
+        .append("\r\n");
+    info.append("mem_fragmentation_ratio:")
+        .append(ratio(rss && sum.total() ? static_cast<double>(rss) / sum.total() : 1.0))
+        .append("\r\n");
+    info.append("active_defrag_enabled:").append(storage.active_defrag_enabled() ? "1" : "0").append("\r\n");
+    info_field(info, "maxmemory", storage.maxmemory());
+    info.append("maxmemory_policy:").append(eviction_policy_name(storage.eviction_policy())).append("\r\n");
+    // The largest shard against the mean: 1.00 is perfectly even.
+    size_t keyspace = sum.dataset + sum.hashtable + sum.expires;
+    double skew = keyspace ? static_cast<double>(sum.shard_max) * shards / keyspace : 1.0;
+    info_field(info, "mem_shard_min", sum.shard_min);
+    info_field(info, "mem_shard_max", sum.shard_max);
+    info.append("mem_shard_skew:").append(ratio(skew)).append("\r\n");
+}
+
+void info_stats(StorageEngine& storage, std::string& info) {
+    const TtlManager& expiry = storage.expiry();
+    info += "# Stats\r\n";
+    info_field(info, "expired_keys", expiry.expired_keys());
+    info_field(info, "expired_keys_per_sec", expiry.expired_per_sec());
+    info_field(info, "evicted_keys", storage.evicted_keys());
+    info_field(info, "active_defrag_hits", storage.defrag_hits());
+}
+
+void info_persistence(StorageEngine& storage, std::string& info) {
+    const AOFWriter* aof = storage.aof();
+    info += "# Persistence\r\n";
+    info.append("aof_enabled:").append(aof ? "1" : "0").append("\r\n");
+    if (!aof)
+        return;
+    info.append("aof_fsync_policy:").append(aof_fsync_name(aof->fsync_policy())).append("\r\n");
+    // Rounds of the AOF writer: each write() and fsync covers every record
+    // staged since the last one.
+    info_field(info, "aof_writes", aof->writes());
+    info_field(info, "aof_fsyncs", aof->fsyncs());
+    AOFRewriter* rewriter = storage.aof_rewriter();
+    info_field(info, "aof_rewrite_in_progress", rewriter->in_progress() ? 1 : 0);
+    info_field(info, "aof_rewrites", rewriter->rewrites());
+    info.append("aof_last_bgrewrite_status:").append(rewriter->last_ok() ? "ok" : "err").append("\r\n");
+    info_field(info, "aof_current_size", aof->file_bytes());
+    info_field(info, "aof_base_size", aof->base_bytes());
+}
+
+// INFO [section]: "memory", "persistence", "stats", or all of them.
+void cmd_info(StorageEngine& storage, CommandArgs cmd, ResponseWriter& out) {
+    if (cmd.size() > 2) {
+        out.error("syntax error");
+        return;
+    }
+    bool all = cmd.size() == 1 || iequals(cmd[1], "ALL") || iequals(cmd[1], "DEFAULT") ||
+               iequals(cmd[1], "EVERYTHING");
+    std::string info;
+    if (all || iequals(cmd[1], "MEMORY"))
+        info_memory(storage, info);
+    if (all || iequals(cmd[1], "PERSISTENCE")) {
+        if (!info.empty())
+            info += "\r\n";
+        info_persistence(storage, info);
+    }
+    if (all || iequals(cmd[1], "STATS")) {
+        if (!info.empty())
+            info += "\r\n";
+        info_stats(storage, info);
+    }
+    out.bulk(info);
+}
+
+void stat_pair(ResponseWriter& out, std::string_view name, uint64_t value) {
+    out.bulk(name);
+    out.integer(static_cast<int64_t>(value));
+}
+
+// MEMORY STATS: name/value pairs, then one nested group per shard.
+void memory_stats(StorageEngine& storage, ResponseWriter& out) {
+    MemorySummary sum = summarize_memory(storage);
+    size_t shards = storage.shard_count();
+    out.array_header(2 * (10 + shards));
+    stat_pair(out, "total.allocated", sum.total());
+    stat_pair(out, "allocator.allocated", sum.slab_used);
+    stat_pair(out, "allocator.active", sum.slab_reserved);
+    stat_pair(out, "allocator.resident", resident_bytes());
+    stat_pair(out, "clients.normal", sum.clients);
+    stat_pair(out, "aof.buffer", sum.aof);
+    stat_pair(out, "overhead.total", sum.overhead());
+    stat_pair(out, "keys.count", sum.keys);
+    stat_pair(out, "keys.bytes-per-key", sum.keys ? sum.dataset / sum.keys : 0);
+    stat_pair(out, "dataset.bytes", sum.dataset);
+    for (size_t i = 0; i < shards; ++i) {
+        Shard::MemoryUsage m = storage.shard_memory(i);
+        out.bulk("shard." + std::to_string(i));
+        out.array_header(2 * 6);
+        stat_pair(out, "keys", storage.shard_keys(i));
+        stat_pair(out, "dataset.bytes", entry_bytes(m));
+        stat_pair(out, "overhead.hashtable.main", m.map.table);
+        stat_pair(out, "overhead.hashtable.expires", m.expires);
+        stat_pair(out, "allocator.allocated", m.slab_used);
+        stat_pair(out, "allocator.active", m.slab_reserved);
+    }
+}
+
+// MEMORY USAGE key [SAMPLES n] | MEMORY STATS. Values are flat strings, so
+// SAMPLES is accepted and has nothing to sample.
+void cmd_memory(StorageEngine& storage, CommandArgs cmd, ResponseWriter& out) {
+    if (iequals(cmd[1], "STATS")) {
+        if (cmd.size() != 2) {
+            out.error("syntax error");
+            return;
+        }
+        memory_stats(storage, out);
+        return;
+    }
+    if (!iequals(cmd[1], "USAGE")) {
+        out.error("unknown subcommand '" + std::string(cmd[1]) + "'");
+        return;
+    }
+    uint64_t samples = 0;
+    if (cmd.size() != 3 && !(cmd.size() == 5 && iequals(cmd[3], "SAMPLES"))) {
+        out.error("syntax error");
+        return;
+    }
+    if (cmd.size() == 5 && !parse_u64(cmd[4], samples)) {
+        out.error("value is not an integer or out of range");
+        return;
+    }
+    size_t bytes = 0;
+    if (storage.key_memory(cmd[2], bytes))
+        out.integer(static_cast<int64_t>(bytes));
+    else
+        out.null();
+}
+
+// ---- table ----
+
+constexpr CommandSpec COMMANDS[] = {
+    // name      arity  flags                                  keys   handler
+    {"PING",     -1,    0,                                     0, 0,  cmd_ping},
+    {"GET",       2,    CMD_READ,                              1, 1,  cmd_get},
+    {"SET",      -3,    CMD_WRITE,                             1, 1,  cmd_set},
+    {"SETEX",     4,    CMD_WRITE,                             1, 1,  cmd_setex},
+    {"PSETEX",    4,    CMD_WRITE,                             1, 1,  cmd_psetex},
+    {"DEL",      -2,    CMD_WRITE | CMD_MULTI_KEY,             1, -1, cmd_del},
+    {"EXISTS",   -2,    CMD_READ | CMD_MULTI_KEY,              1, -1, cmd_exists},
+    {"EXPIRE",    3,    CMD_WRITE,                             1, 1,  cmd_expire},
+    {"PEXPIRE",   3,    CMD_WRITE,                             1, 1,  cmd_pexpire},
+    {"PEXPIREAT", 3,    CMD_WRITE,                             1, 1,  cmd_pexpireat},
+    {"TTL",       2,    CMD_READ,                              1, 1,  cmd_ttl},
+    {"PTTL",      2,    CMD_READ,                              1, 1,  cmd_pttl},
+    {"KEYS",      2,    CMD_READ | CMD_SLOW | CMD_ALL_SHARDS,  0, 0,  cmd_keys},
+    {"DBSIZE",    1,    CMD_READ | CMD_ALL_SHARDS,             0, 0,  cmd_dbsize},
+    {"FLUSHALL", -1,    CMD_WRITE | CMD_SLOW | CMD_ALL_SHARDS, 0, 0,  cmd_flushall},
+    {"BGREWRITEAOF", 1, 0,                                     0, 0,  cmd_bgrewriteaof},
+    {"SCAN",     -2,    CMD_READ | CMD_CURSOR,                 0, 0,  cmd_scan},
+    {"INFO",     -1,    0,                                     0, 0,  cmd_info},
+    {"MEMORY",   -2,    CMD_READ,                              2, 2,  cmd_memory},
+};
+
+constexpr size_t COMMAND_COUNT = sizeof(COMMANDS) / sizeof(COMMANDS[0]);
+constexpr size_t MAX_NAME = 16;
+constexpr size_t SLOTS = 64;  // power of two, comfortably above COMMAND_COUNT
+
+constexpr char fold(char c) {
+    return (c >= 'a' && c <= 'z') ? static_cast<char>(c - 'a' + 'A') : c;
+}
+
+// FNV-1a over the upper-cased name, perturbed by seed.
+constexpr uint32_t name_hash(std::string_view name, uint32_t seed) {
+    uint32_t h = 2166136261u ^ (seed * 0x9e3779b9u);
+    for (char c : name) {
+        h ^= static_cast<uint8_t>(fold(c));
+        h *= 16777619u;
+    }
+    return h ^ (h >> 15);
+}
+
+constexpr bool seed_is_perfect(uint32_t seed) {
+    bool used[SLOTS] = {};
+    for (const auto& spec : COMMANDS) {
+        size_t slot = name_hash(spec.name, seed) & (SLOTS - 1);
+        if (used[slot]) return false;
+        used[slot] = true;
+    }
+    return true;
+}
+
+constexpr uint32_t find_seed() {
+    for (uint32_t seed = 0; seed < 100000; ++seed)
+        if (seed_is_perfect(seed)) return seed;
+    return UINT32_MAX;
+}
+
+constexpr uint32_t SEED = find_seed();
+static_assert(SEED != UINT32_MAX, "no perfect hash seed for the command table; grow SLOTS");
+
+constexpr std::array<int8_t, SLOTS> build_slots() {
+    std::array<int8_t, SLOTS> slots{};
+    for (auto& s : slots) s = -1;
+    for (size_t i = 0; i < COMMAND_COUNT; ++i)
+        slots[name_hash(COMMANDS[i].name, SEED) & (SLOTS - 1)] = static_cast<int8_t>(i);
+    return slots;
+}
+
+constexpr std::array<int8_t, SLOTS> SLOT_TABLE = build_slots();
+
+constexpr bool names_fit() {
+    for (const auto& spec : COMMANDS)
+        if (spec.name.size() > MAX_NAME) return false;
+    return true;
+}
+static_assert(names_fit(), "command name longer than MAX_NAME");
+
+} // namespace
+
+const CommandSpec* lookup_command(std::string_view name) {
+    if (name.empty() || name.size() > MAX_NAME)
+        return nullptr;
+    int8_t idx = SLOT_TABLE[name_hash(name, SEED) & (SLOTS - 1)];
+    if (idx < 0)
+        return nullptr;
+    const CommandSpec& spec = COMMANDS[idx];
+    if (spec.name.size() != name.size())
+        return nullptr;
+    for (size_t i = 0; i < name.size(); ++i)
+        if (fold(name[i]) != spec.name[i])
+            return nullptr;
+    return &spec;
+}
+
+} // namespace mini_redis::protocol
@@ -1,57 +1,118 @@
 #include "protocol/parser.hpp"
-#include <cstdlib>
 
-namespace protocol {
-
-bool RespParser::parse_array(
-        const std::string& in,
-        size_t& pos,
-        std::vector<std::string>& out)
-{
-    size_t start = pos;
+#include <algorithm>
+#include <charconv>
+#include <cstring>
 
-    if (pos >= in.size() || in[pos] != '*')
-        return false;
-
-    pos++;
+namespace protocol {
 
-    size_t end = in.find("\r\n", pos);
-    if (end == std::string::npos)
-        return false;
+namespace {
+
+constexpr size_t MAX_HEADER = 32;                  // "*<count>\r\n" / "$<len>\r\n"
+constexpr int64_t MAX_ARGS = 1024 * 1024;
+constexpr int64_t MAX_BULK_LEN = 512LL * 1024 * 1024;
+
+} // namespace
+
+RespParser::Status RespParser::read_length(std::string_view frame, char prefix, int64_t& out) {
+    if (scanned_ >= frame.size())
+        return Status::INCOMPLETE;
+    if (frame[scanned_] != prefix)
+        return Status::ERROR;
+
+    // Header lines are short and bounded, so re-reading a partial one on the
+    // next call is cheap; memchr does the CR scan a word (or vector) at a time.
+    const char* digits = frame.data() + scanned_ + 1;
+    size_t avail = frame.size() - scanned_ - 1;
+    const char* cr = static_cast<const char*>(
+        std::memchr(digits, '\r', std::min(avail, MAX_HEADER)));
+    if (!cr)
+        return avail >= MAX_HEADER ? Status::ERROR : Status::INCOMPLETE;
+    size_t n = static_cast<size_t>(cr - digits);
+    if (n + 1 >= avail)
+        return Status::INCOMPLETE;
+    if (cr[1] != '\n')
+        return Status::ERROR;
+
+    int64_t value = 0;
+    auto [end, ec] = std::from_chars(digits, cr, value);
+    if (ec != std::errc() || end != cr)
+        return Status::ERROR;
+
+    out = value;
+    scanned_ += 1 + n + 2;
+    return Status::COMPLETE;
+}
 
-    int count = std::stoi(in.substr(pos, end - pos));
-    pos = end + 2;
+RespParser::Status RespParser::parse(std::string_view frame) {
+    if (done_) {
+        done_ = false;
+        scanned_ = 0;
+        remaining_ = -1;
+        bulk_len_ = -1;
+        args_.clear();
+    }
 
-    for (int i = 0; i < count; ++i) {
+    if (remaining_ < 0) {
+        int64_t count = 0;
+        Status s = read_length(frame, '*', count);
+        if (s != Status::COMPLETE)
+            return s;
+        if (count > MAX_ARGS)
+            return Status::ERROR;
+        remaining_ = count < 0 ? 0 : count;
+    }
 
-        if (pos >= in.size() || in[pos] != '$') {
-            pos = start;
-            return false;
+    while (remaining_ > 0) {
+        if (bulk_len_ < 0) {
+            Status s = read_length(frame, '$', bulk_len_);
+            if (s != Status::COMPLETE)
+                return s;
+            if (bulk_len_ < 0 || bulk_len_ > MAX_BULK_LEN)
+                return Status::ERROR;
         }
 
-        pos++;
-
-        end = in.find("\r\n", pos);
-        if (end == std::string::npos) {
-            pos = start;
-            return false;
-        }
+        size_t len = static_cast<size_t>(bulk_len_);
+        size_t end = scanned_ + len + 2;
+        if (frame.size() < end)
+            return Status::INCOMPLETE;
+        if (frame[end - 2] != '\r' || frame[end - 1] != '\n')
+            return Status::ERROR;
+
+        args_.push_back({scanned_, len});
+        scanned_ = end;
+        bulk_len_ = -1;
+        --remaining_;
+    }
 
-        int len = std::stoi(in.substr(pos, end - pos));
-        pos = end + 2;
+    done_ = true;
+    return Status::COMPLETE;
+}
 
-        if (pos + len + 2 > in.size()) {
-            pos = start;
-            return false;
-        }
+size_t RespParser::bytes_needed() const {
+    if (done_ || bulk_len_ < 0)
+        return 0;
+    return scanned_ + static_cast<size_t>(bulk_len_) + 2;
+}
 
-        out.push_back(in.substr(pos, len));
+void CommandBatch::add(size_t frame_offset, const std::vector<RespParser::Arg>& args) {
+    for (const auto& a : args)
+        args_.push_back({frame_offset + a.offset, a.length});
+    ends_.push_back(args_.size());
+}
 
-        pos += len + 2;
+void CommandBatch::append(CommandBatch&& other) {
+    if (empty()) {
+        *this = std::move(other);
+        return;
     }
-
-    return true;
+    size_t base = data_.size();
+    size_t arg_base = args_.size();
+    data_ += other.data_;
+    for (const auto& a : other.args_)
+        args_.push_back({base + a.offset, a.length});
+    for (size_t end : other.ends_)
+        ends_.push_back(arg_base + end);
 }
 
 }
-
@@ -1,39 +1,49 @@
 #include "protocol/response.hpp"
+#include "net/buffer.hpp"
+#include "storage/value.hpp"
 
 namespace protocol {
 
-std::string RespResponse::ok() {
-    return "+OK\r\n";
-}
+namespace {
 
-std::string RespResponse::error(
-        const std::string& msg) {
-    return "-" + msg + "\r\n";
-}
+// Below this, copying into the open chunk is cheaper than an extra iovec.
+constexpr size_t LINK_MIN_BYTES = 4096;
 
-std::string RespResponse::bulk(
-        const std::string& val) {
+} // namespace
 
-    return "$" +
-        std::to_string(val.size()) +
-        "\r\n" +
-        val +
-        "\r\n";
-}
+ResponseWriter::ResponseWriter(net::OutputBuffer& chain)
+    : out_(&chain.tail()), chain_(&chain) {}
 
-std::string RespResponse::null() {
-    return "$-1\r\n";
+void ResponseWriter::bulk(const mini_redis::Value& value) {
+    char scratch[mini_redis::Value::INT_CHARS];
+    std::string_view bytes = value.bytes(scratch);
+    if (!chain_ || bytes.size() < LINK_MIN_BYTES ||
+        value.encoding() != mini_redis::Value::Encoding::BLOB) {
+        bulk(bytes);
+        return;
+    }
+    header('$', static_cast<int64_t>(bytes.size()));
+    chain_->link(value.share());
+    out_ = &chain_->tail();
+    out_->append("\r\n", 2);
 }
 
-std::string RespResponse::integer(int64_t value) {
-    return ":" + std::to_string(value) + "\r\n";
+void ResponseWriter::error(std::string_view msg) {
+    out_->push_back('-');
+    out_->append(msg);
+    out_->append("\r\n", 2);
 }
 
-std::string RespResponse::array(const std::vector<std::string>& elements) {
-    std::string r = "*" + std::to_string(elements.size()) + "\r\n";
+void ResponseWriter::array(const std::vector<std::string>& elements) {
+    // Size the whole reply first so a large KEYS result grows the buffer once.
+    size_t total = 16;
+    for (const auto& s : elements)
+        total += s.size() + 16;
+    out_->reserve(out_->size() + total);
+
+    header('*', static_cast<int64_t>(elements.size()));
     for (const auto& s : elements)
-        r += bulk(s);
-    return r;
+        bulk(s);
 }
 
 }
@@ -2,74 +2,305 @@
 
 namespace mini_redis {
 
-bool Shard::get(const std::string& key, Value& out, uint64_t now) {
-    {
-        std::shared_lock lock(mutex_);
-        auto it = map_.find(key);
-        if (it == map_.end()) {
-            return false;
+namespace {
+
+// A scan step visits at most this many groups per requested key, so walking
+// a sparse table still costs O(count).
+constexpr size_t SCAN_GROUPS_PER_KEY = 10;
+
+// Evictions one write may perform. Past this the write goes ahead and the
+// next writes continue, so a lowered budget is reached gradually.
+constexpr size_t EVICT_PER_WRITE = 16;
+// Slots an eviction sample may look through (volatile-ttl skips keys
+// without an expiry).
+constexpr size_t SAMPLE_SLOTS = 256;
+
+// Arena slack, per shard, that is never worth a defrag pass.
+constexpr size_t DEFRAG_IGNORE_BYTES = 1024 * 1024;
+
+} // namespace
+
+Shard::Shard() : arena_(SlabArena::acquire()) {
+    map_.set_arena(arena_);
+}
+
+Shard::~Shard() {
+    // The map frees its nodes after this body; the pooled arena stays
+    // valid for them and for blobs replies still hold.
+    arena_->release();
+}
+
+void Shard::set_exclusive(bool exclusive) {
+    exclusive_ = exclusive;
+    map_.set_deferred_reclaim(!exclusive);
+}
+
+concurrency::EpochGuard Shard::read_guard() const {
+    return concurrency::EpochGuard(!exclusive_);
+}
+
+std::unique_lock<std::mutex> Shard::write_lock() {
+    if (exclusive_)
+        return std::unique_lock<std::mutex>(mutex_, std::defer_lock);
+    return std::unique_lock<std::mutex>(mutex_);
+}
+
+void Shard::schedule_expiry(std::string_view key, uint64_t hash, uint64_t old_expire_at,
+                            uint64_t expire_at, uint64_t now) {
+    // An entry due at or before the new deadline is already filed.
+    if (expire_at == 0 || (old_expire_at != 0 && old_expire_at <= expire_at))
+        return;
+    wheel_.schedule(key, hash, expire_at, now);
+    note_wheel();
+}
+
+size_t Shard::expire_slice(uint64_t now, size_t budget, bool& backlog) {
+    std::unique_lock<std::mutex> lock(mutex_, std::defer_lock);
+    if (!exclusive_ && !lock.try_lock()) {
+        backlog = true;
+        return 0;
+    }
+    wheel_.advance(now);
+    size_t expired = 0;
+    TimingWheel::Entry e;
+    for (size_t n = 0; n < budget; ++n) {
+        if (!wheel_.pop_due(e))
+            break;
+        const Value* v = map_.find(e.key, e.hash);
+        if (!v || v->expire_at == 0)
+            continue;  // deleted, or persisted by a plain SET
+        if (v->is_expired(now)) {
+            map_.erase(e.key, e.hash);
+            ++expired;
+        } else {
+            e.deadline = v->expire_at;  // TTL was extended
+            wheel_.schedule(std::move(e));
         }
+    }
+    note_wheel();
+    backlog = backlog || wheel_.has_due();
+    return expired;
+}
+
+bool Shard::rehash_slice(size_t slots) {
+    std::unique_lock<std::mutex> lock(mutex_, std::defer_lock);
+    if (!exclusive_ && !lock.try_lock())
+        return map_.rehashing();
+    return map_.rehash_step(slots);
+}
 
-        if (!it->second.is_expired(now)) {
-            out = it->second;
+void Shard::set_memory_budget(size_t bytes, EvictionPolicy policy, size_t samples) {
+    auto lock = write_lock();
+    budget_ = bytes;
+    policy_ = policy;
+    samples_ = samples > 0 ? samples : 1;
+}
+
+bool Shard::make_room(uint64_t now, std::vector<std::string>* evicted) {
+    for (size_t n = 0; map_.memory_bytes() > budget_; ++n) {
+        if (n == EVICT_PER_WRITE)
             return true;
-        }
+        if (policy_ == EvictionPolicy::NOEVICTION || !evict_one(now, evicted))
+            return false;
     }
+    return true;
+}
 
-    // If expired, delete lazily
-    {
-        std::unique_lock lock(mutex_);
-        auto it = map_.find(key);
-        if (it != map_.end() && it->second.is_expired(now)) {
-            map_.erase(it);
+bool Shard::evict_one(uint64_t now, std::vector<std::string>* evicted) {
+    const Map::Node* best = nullptr;
+    uint64_t best_score = 0;
+    size_t sampled = 0;
+    map_.visit_from(static_cast<size_t>(eviction::fast_rand()), SAMPLE_SLOTS, [&](const Map::Node& n) {
+        if (n.value.is_expired(now)) {
+            best = &n;  // already dead: take it
+            return false;
         }
+        if (policy_ == EvictionPolicy::VOLATILE_TTL && n.value.expire_at == 0)
+            return true;
+        uint64_t score = eviction::score(policy_, n.access.load(std::memory_order_relaxed),
+                                         n.value.expire_at, now);
+        if (!best || score > best_score) {
+            best = &n;
+            best_score = score;
+        }
+        return ++sampled < samples_;
+    });
+    if (!best)
+        return false;
+    if (!best->value.is_expired(now)) {
+        evicted_.store(evicted_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if (evicted)
+            evicted->emplace_back(best->key.view());
     }
+    map_.erase(best->key.view(), best->hash);
+    return true;
+}
 
-    return false;
+bool Shard::get(std::string_view key, uint64_t hash, Value& out, uint64_t now) {
+    auto guard = read_guard();
+    const Map::Node* n = map_.find_entry(key, hash);
+    if (!n || n->value.is_expired(now))
+        return false;
+    if (policy_ != EvictionPolicy::NOEVICTION) {
+        uint32_t stamp = n->access.load(std::memory_order_relaxed);
+        uint32_t touched = eviction::touched_stamp(policy_, stamp, now);
+        if (touched != stamp)
+            n->access.store(touched, std::memory_order_relaxed);
+    }
+    out = n->value;
+    return true;
 }
 
-void Shard::set(const std::string& key, Value value) {
-    std::unique_lock lock(mutex_);
-    map_[key] = std::move(value);
+bool Shard::set(std::string_view key, uint64_t hash, std::string_view value, uint64_t expire_at,
+                uint64_t now, std::vector<std::string>* evicted) {
+    auto lock = write_lock();
+    if (budget_ != 0 && !make_room(now, evicted))
+        return false;
+    if (expire_at != 0) {
+        const Value* old = map_.find(key, hash);
+        schedule_expiry(key, hash, old ? old->expire_at : 0, expire_at, now);
+    }
+    map_.insert_or_assign(key, hash, Value(value, expire_at, arena_),
+                          eviction::initial_stamp(policy_, now));
+    return true;
 }
 
-bool Shard::del(const std::string& key) {
-    std::unique_lock lock(mutex_);
-    return map_.erase(key) > 0;
+bool Shard::del(std::string_view key, uint64_t hash, uint64_t now) {
+    auto lock = write_lock();
+    // An expired entry is already gone as far as clients can tell.
+    const Value* v = map_.find(key, hash);
+    bool removed = v && !v->is_expired(now);
+    map_.erase(key, hash);
+    return removed;
 }
 
-bool Shard::exists(const std::string& key, uint64_t now) {
-    std::shared_lock lock(mutex_);
-    auto it = map_.find(key);
-    if (it == map_.end()) return false;
-    if (it->second.is_expired(now)) return false;
-    return true;
+bool Shard::exists(std::string_view key, uint64_t hash, uint64_t now) {
+    auto guard = read_guard();
+    const Value* v = map_.find(key, hash);
+    return v && !v->is_expired(now);
 }
 
-bool Shard::set_expire(const std::string& key, uint64_t expire_at, uint64_t now) {
-    std::unique_lock lock(mutex_);
-    auto it = map_.find(key);
-    if (it == map_.end() || it->second.is_expired(now)) return false;
-    it->second.expire_at = expire_at;
-    return true;
+bool Shard::set_expire(std::string_view key, uint64_t hash, uint64_t expire_at, uint64_t now) {
+    auto lock = write_lock();
+    uint64_t old_expire_at = 0;
+    bool updated = map_.update(key, hash, [&](Value& v) {
+        if (v.is_expired(now))
+            return false;
+        old_expire_at = v.expire_at;
+        v.expire_at = expire_at;
+        return true;
+    });
+    if (updated)
+        schedule_expiry(key, hash, old_expire_at, expire_at, now);
+    return updated;
 }
 
-int64_t Shard::ttl(const std::string& key, uint64_t now) {
-    std::shared_lock lock(mutex_);
-    auto it = map_.find(key);
-    if (it == map_.end()) return -2;
-    if (it->second.is_expired(now)) return -2;
-    if (it->second.expire_at == 0) return -1;
-    auto rem = static_cast<int64_t>(it->second.expire_at - now);
+int64_t Shard::pttl(std::string_view key, uint64_t hash, uint64_t now) {
+    auto guard = read_guard();
+    const Value* v = map_.find(key, hash);
+    if (!v || v->is_expired(now)) return -2;
+    if (v->expire_at == 0) return -1;
+    auto rem = static_cast<int64_t>(v->expire_at - now);
     return rem > 0 ? rem : 0;
 }
 
-void Shard::keys(uint64_t now, std::vector<std::string>& out) {
-    std::shared_lock lock(mutex_);
-    for (const auto& [k, v] : map_) {
+void Shard::keys(uint64_t now, const Glob& pattern, std::vector<std::string>& out) {
+    auto guard = read_guard();
+    map_.for_each([&](std::string_view k, const Value& v) {
+        if (!v.is_expired(now) && pattern.matches(k))
+            out.emplace_back(k);
+    });
+}
+
+void Shard::snapshot(uint64_t now, Snapshot& out) {
+    auto lock = write_lock();
+    out.reserve(out.size() + map_.size());
+    map_.for_each([&](std::string_view k, const Value& v) {
         if (!v.is_expired(now))
-            out.push_back(k);
+            out.emplace_back(k, v);
+    });
+}
+
+void Shard::clear(const std::function<void()>& locked) {
+    auto lock = write_lock();
+    map_.clear();
+    wheel_.clear();
+    note_wheel();
+    if (locked)
+        locked();
+}
+
+Shard::MemoryUsage Shard::memory_usage() const {
+    MemoryUsage m;
+    m.map = map_.memory_usage();
+    m.expires = wheel_bytes_.load(std::memory_order_relaxed);
+    m.slab_reserved = arena_->reserved_bytes();
+    m.slab_used = arena_->used_bytes();
+    return m;
+}
+
+size_t Shard::defrag_slice(size_t budget, size_t threshold_pct, bool& running) {
+    std::unique_lock<std::mutex> lock(mutex_, std::defer_lock);
+    if (!exclusive_ && !lock.try_lock())
+        return 0;
+    arena_->collect();
+    if (!defragging_) {
+        if (!arena_->fragmented(threshold_pct, DEFRAG_IGNORE_BYTES) || !arena_->begin_defrag())
+            return 0;
+        defragging_ = true;
+        defrag_cursor_ = 0;
+    }
+    size_t moved = 0;
+    defrag_cursor_ = map_.rebuild_from(defrag_cursor_, budget, [&](const Map::Node& n, Value& v) {
+        bool move = (n.in_slab && SlabArena::evacuating(&n));
+        if (const void* k = n.key.slab_block())
+            move = move || SlabArena::evacuating(k);
+        if (const void* b = v.slab_block(); b && SlabArena::evacuating(b)) {
+            v = v.relocated(arena_);
+            move = true;
+        }
+        moved += move;
+        return move;
+    });
+    arena_->collect();  // the old copies, if already freed
+    if (defrag_cursor_ == 0) {
+        arena_->end_defrag();
+        defragging_ = false;
+    }
+    defrag_hits_.store(defrag_hits_.load(std::memory_order_relaxed) + moved, std::memory_order_relaxed);
+    running = running || defragging_;
+    return moved;
+}
+
+void Shard::reclaim() {
+    std::unique_lock<std::mutex> lock(mutex_, std::defer_lock);
+    if (!exclusive_ && !lock.try_lock())
+        return;
+    arena_->collect();
+}
+
+bool Shard::key_memory(std::string_view key, uint64_t hash, uint64_t now, size_t& out) {
+    auto guard = read_guard();
+    const Map::Node* n = map_.find_entry(key, hash);
+    if (!n || n->value.is_expired(now))
+        return false;
+    out = Map::entry_bytes(*n);
+    return true;
+}
+
+uint64_t Shard::scan(uint64_t cursor, size_t count, uint64_t now, std::vector<std::string>& out) {
+    auto guard = read_guard();
+    size_t start = out.size();
+    size_t max_groups = count * SCAN_GROUPS_PER_KEY;
+    for (size_t groups = 0; groups < max_groups; ++groups) {
+        cursor = map_.scan(cursor, [&](std::string_view k, const Value& v) {
+            if (!v.is_expired(now))
+                out.emplace_back(k);
+        });
+        if (cursor == 0 || out.size() - start >= count)
+            break;
     }
+    return cursor;
 }
 
 } // namespace mini_redis
@@ -0,0 +1,318 @@
+#include "storage/slab.hpp"
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <mutex>
+#include <new>
+
+namespace mini_redis {
+
+namespace {
+
+constexpr size_t SLAB_BYTES = SlabArena::SLAB_BYTES;
+constexpr size_t HEADER = 64;        // slab header; objects follow
+constexpr size_t CHUNK_SLABS = 32;   // slabs mapped at a time (2 MiB)
+constexpr size_t CHUNK_BYTES = CHUNK_SLABS * SLAB_BYTES;
+
+// 16-byte steps up to 128 (nodes are 64, the smallest blob 31), then four
+// classes per doubling, so rounding wastes at most 20%.
+constexpr size_t CLASS_COUNT = 8 + 4 * 5;
+
+constexpr std::array<uint32_t, CLASS_COUNT> CLASS_SIZES = [] {
+    std::array<uint32_t, CLASS_COUNT> sizes{};
+    size_t n = 0;
+    for (uint32_t s = 16; s <= 128; s += 16)
+        sizes[n++] = s;
+    for (uint32_t base = 128; base < SlabArena::MAX_OBJECT; base *= 2)
+        for (uint32_t k = 1; k <= 4; ++k)
+            sizes[n++] = base + base / 4 * k;
+    return sizes;
+}();
+
+static_assert(CLASS_SIZES[CLASS_COUNT - 1] == SlabArena::MAX_OBJECT);
+
+// Class for a request of up to 16 * i bytes.
+constexpr std::array<uint8_t, SlabArena::MAX_OBJECT / 16 + 1> CLASS_OF = [] {
+    std::array<uint8_t, SlabArena::MAX_OBJECT / 16 + 1> of{};
+    uint8_t c = 0;
+    for (size_t i = 0; i < of.size(); ++i) {
+        while (CLASS_SIZES[c] < i * 16)
+            ++c;
+        of[i] = c;
+    }
+    return of;
+}();
+
+struct Pool {
+    std::mutex mutex;
+    std::vector<SlabArena*> free;
+};
+
+Pool& pool() {
+    static Pool* p = new Pool;  // outlives every shard
+    return *p;
+}
+
+// CHUNK_BYTES aligned to SLAB_BYTES, so any object's slab header is found
+// by masking its address.
+char* map_chunk() {
+    size_t len = CHUNK_BYTES + SLAB_BYTES;
+    void* p = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+        perror("mmap");
+        return nullptr;
+    }
+    uintptr_t start = reinterpret_cast<uintptr_t>(p);
+    uintptr_t aligned = (start + SLAB_BYTES - 1) & ~(SLAB_BYTES - 1);
+    size_t head = aligned - start;
+    if (head > 0)
+        munmap(p, head);
+    if (SLAB_BYTES - head > 0)
+        munmap(reinterpret_cast<char*>(aligned) + CHUNK_BYTES, SLAB_BYTES - head);
+    return reinterpret_cast<char*>(aligned);
+}
+
+void add(std::atomic<size_t>& counter, size_t bytes) {
+    counter.store(counter.load(std::memory_order_relaxed) + bytes, std::memory_order_relaxed);
+}
+
+void sub(std::atomic<size_t>& counter, size_t bytes) {
+    counter.store(counter.load(std::memory_order_relaxed) - bytes, std::memory_order_relaxed);
+}
+
+} // namespace
+
+struct SlabArena::Slab {
+    SlabArena* arena;
+    Slab* prev;  // class partial list
+    Slab* next;
+    void* free;  // freed objects, linked through their first word
+    uint32_t used;
+    uint32_t carved;  // objects handed out from the untouched tail so far
+    uint32_t capacity;
+    uint32_t size;
+    uint8_t cls;
+    bool listed;  // on the partial list
+    bool evacuating;
+};
+
+SlabArena::SlabArena() : classes_(CLASS_COUNT) {}
+
+SlabArena* SlabArena::acquire() {
+    Pool& p = pool();
+    std::lock_guard lock(p.mutex);
+    if (p.free.empty())
+        return new SlabArena;
+    SlabArena* arena = p.free.back();
+    p.free.pop_back();
+    return arena;
+}
+
+void SlabArena::release() {
+    collect();
+    Pool& p = pool();
+    std::lock_guard lock(p.mutex);
+    p.free.push_back(this);
+}
+
+SlabArena::Slab* SlabArena::slab_of(const void* p) {
+    return reinterpret_cast<Slab*>(reinterpret_cast<uintptr_t>(p) & ~(SLAB_BYTES - 1));
+}
+
+void* SlabArena::allocate(size_t bytes) {
+    if (bytes > MAX_OBJECT)
+        return nullptr;
+    if (remote_.load(std::memory_order_relaxed))
+        collect();
+    size_t cls = CLASS_OF[(bytes + 15) / 16];
+    Slab* s = classes_[cls].partial;
+    if (!s && !(s = new_slab(cls)))
+        return nullptr;
+    void* p;
+    if (s->free) {
+        p = s->free;
+        s->free = *static_cast<void**>(p);
+    } else {
+        p = reinterpret_cast<char*>(s) + HEADER + size_t{s->carved++} * s->size;
+    }
+    if (++s->used == s->capacity)
+        unlink(s);
+    add(used_, s->size);
+    return p;
+}
+
+void SlabArena::free(void* p) {
+    SlabArena* arena = slab_of(p)->arena;
+    void* head = arena->remote_.load(std::memory_order_relaxed);
+    do {
+        *static_cast<void**>(p) = head;
+    } while (!arena->remote_.compare_exchange_weak(head, p, std::memory_order_release,
+                                                   std::memory_order_relaxed));
+}
+
+void SlabArena::collect() {
+    void* p = remote_.exchange(nullptr, std::memory_order_acquire);
+    while (p) {
+        void* next = *static_cast<void**>(p);
+        free_local(p);
+        p = next;
+    }
+}
+
+void SlabArena::free_local(void* p) {
+    Slab* s = slab_of(p);
+    *static_cast<void**>(p) = s->free;
+    s->free = p;
+    --s->used;
+    sub(used_, s->size);
+    // Keep a class's last slab rather than remap it on the next write.
+    if (s->used == 0 && classes_[s->cls].slabs > 1) {
+        release_slab(s);
+        return;
+    }
+    if (!s->listed && !s->evacuating)
+        link(s);
+}
+
+SlabArena::Slab* SlabArena::new_slab(size_t cls) {
+    if (empty_.empty()) {
+        char* base = map_chunk();
+        if (!base)
+            return nullptr;
+        chunks_.push_back(std::make_unique<Chunk>(Chunk{base, 0}));
+        for (size_t i = CHUNK_SLABS; i-- > 0;)
+            empty_.push_back(reinterpret_cast<Slab*>(base + i * SLAB_BYTES));
+    }
+    Slab* s = empty_.back();
+    empty_.pop_back();
+    for (auto& c : chunks_) {
+        if (reinterpret_cast<char*>(s) >= c->base && reinterpret_cast<char*>(s) < c->base + CHUNK_BYTES) {
+            ++c->live;
+            break;
+        }
+    }
+    static_assert(sizeof(Slab) <= HEADER);
+    uint32_t size = CLASS_SIZES[cls];
+    new (s) Slab{this, nullptr, nullptr, nullptr, 0, 0,
+                 static_cast<uint32_t>((SLAB_BYTES - HEADER) / size), size,
+                 static_cast<uint8_t>(cls), false, false};
+    ++classes_[cls].slabs;
+    add(reserved_, SLAB_BYTES);
+    link(s);
+    return s;
+}
+
+void SlabArena::release_slab(Slab* s) {
+    if (s->listed)
+        unlink(s);
+    if (s->evacuating)
+        evacuating_.erase(std::find(evacuating_.begin(), evacuating_.end(), s));
+    --classes_[s->cls].slabs;
+    sub(reserved_, SLAB_BYTES);
+    for (size_t i = 0; i < chunks_.size(); ++i) {
+        Chunk& c = *chunks_[i];
+        if (reinterpret_cast<char*>(s) < c.base || reinterpret_cast<char*>(s) >= c.base + CHUNK_BYTES)
+            continue;
+        // Keep one chunk mapped so a small shard does not map and unmap.
+        if (--c.live == 0 && chunks_.size() > 1) {
+            unmap_chunk(i);
+            return;
+        }
+        break;
+    }
+    madvise(s, SLAB_BYTES, MADV_DONTNEED);
+    empty_.push_back(s);
+}
+
+void SlabArena::unmap_chunk(size_t index) {
+    char* base = chunks_[index]->base;
+    std::erase_if(empty_, [base](Slab* s) {
+        return reinterpret_cast<char*>(s) >= base && reinterpret_cast<char*>(s) < base + CHUNK_BYTES;
+    });
+    munmap(base, CHUNK_BYTES);
+    chunks_.erase(chunks_.begin() + static_cast<std::ptrdiff_t>(index));
+}
+
+// New room goes after the head, so the slab being filled stays in front.
+void SlabArena::link(Slab* s) {
+    SizeClass& sc = classes_[s->cls];
+    Slab* head = sc.partial;
+    if (!head) {
+        s->prev = s->next = nullptr;
+        sc.partial = s;
+    } else {
+        s->prev = head;
+        s->next = head->next;
+        if (head->next)
+            head->next->prev = s;
+        head->next = s;
+    }
+    s->listed = true;
+}
+
+void SlabArena::unlink(Slab* s) {
+    SizeClass& sc = classes_[s->cls];
+    if (s->prev)
+        s->prev->next = s->next;
+    else
+        sc.partial = s->next;
+    if (s->next)
+        s->next->prev = s->prev;
+    s->prev = s->next = nullptr;
+    s->listed = false;
+}
+
+bool SlabArena::fragmented(size_t threshold_pct, size_t ignore_bytes) const {
+    size_t reserved = reserved_bytes();
+    size_t used = used_bytes();
+    return reserved > used + ignore_bytes && (reserved - used) * 100 > used * threshold_pct;
+}
+
+bool SlabArena::begin_defrag() {
+    collect();
+    std::vector<Slab*> candidates;
+    for (SizeClass& sc : classes_) {
+        if (sc.slabs < 2)
+            continue;
+        // Only slabs that were filled once and have since emptied out: one
+        // still being carved is where new objects are going.
+        candidates.clear();
+        size_t room = 0;  // free objects across the class's partial slabs
+        for (Slab* s = sc.partial; s; s = s->next) {
+            room += s->capacity - s->used;
+            if (s->carved == s->capacity)
+                candidates.push_back(s);
+        }
+        // Sparsest first, while the slabs left behind can take their objects.
+        std::sort(candidates.begin(), candidates.end(),
+                  [](const Slab* a, const Slab* b) { return a->used < b->used; });
+        for (Slab* s : candidates) {
+            room -= s->capacity - s->used;
+            if (s->used > room)
+                break;
+            room -= s->used;
+            unlink(s);
+            s->evacuating = true;
+            evacuating_.push_back(s);
+        }
+    }
+    return !evacuating_.empty();
+}
+
+void SlabArena::end_defrag() {
+    for (Slab* s : evacuating_) {
+        s->evacuating = false;
+        if (s->used < s->capacity)
+            link(s);
+    }
+    evacuating_.clear();
+}
+
+bool SlabArena::evacuating(const void* p) {
+    return slab_of(p)->evacuating;
+}
+
+} // namespace mini_redis
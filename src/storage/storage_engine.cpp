@@ -1,138 +1,333 @@
 #include "storage/storage_engine.hpp"
 #include "persistence/aof_reader.hpp"
-#include <functional>
-#include <chrono>
+#include "common/hash.hpp"
+#include "common/glob.hpp"
+#include "common/time.hpp"
 #include <algorithm>
+#include <iterator>
+#include <bit>
 
 namespace mini_redis {
 
 namespace {
 
-// Simple glob: * = any chars, ? = one char (Redis-style)
-bool match_pattern(const std::string& pattern, const std::string& key) {
-    size_t pi = 0, ki = 0;
-    size_t star_pi = std::string::npos, star_ki = std::string::npos;
-    while (ki < key.size()) {
-        if (pi < pattern.size() && (pattern[pi] == '*' || pattern[pi] == '?')) {
-            if (pattern[pi] == '*') {
-                star_pi = pi;
-                star_ki = ki;
-                ++pi;
-                continue;
-            }
-            ++pi;
-            ++ki;
-            continue;
-        }
-        if (pi < pattern.size() && pattern[pi] == key[ki]) {
-            ++pi;
-            ++ki;
-            continue;
-        }
-        if (star_pi != std::string::npos) {
-            pi = star_pi + 1;
-            ki = ++star_ki;
-            continue;
-        }
-        return false;
-    }
-    while (pi < pattern.size() && pattern[pi] == '*') ++pi;
-    return pi == pattern.size();
-}
+// SCAN cursor: shard index above this bit, that shard's cursor below.
+constexpr unsigned SCAN_SHARD_SHIFT = 48;
+constexpr uint64_t SCAN_POS_MASK = (uint64_t{1} << SCAN_SHARD_SHIFT) - 1;
+
+// Below this many entries a keyspace walk is cheaper than waking workers.
+constexpr size_t PARALLEL_MIN_KEYS = 1 << 16;
+
+thread_local size_t current_core = 0;
 
 } // namespace
 
 StorageEngine::StorageEngine(size_t shard_count)
-    : shards_(shard_count) {}
+    : shards_(std::bit_ceil(std::max<size_t>(shard_count, 1))),
+      shard_mask_(shards_.size() - 1) {}
 
-Shard& StorageEngine::shard_for(const std::string& key) {
-    size_t idx = std::hash<std::string>{}(key) % shards_.size();
-    return shards_[idx];
+void StorageEngine::partition(size_t cores) {
+    cores_ = cores;
+    shard_owner_.assign(shards_.size(), 0);
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        shards_[i].set_exclusive(cores > 0);
+        if (cores > 0)
+            shard_owner_[i] = i % cores;
+    }
 }
 
-uint64_t StorageEngine::now_seconds() const {
-    using namespace std::chrono;
-    return duration_cast<seconds>(
-        steady_clock::now().time_since_epoch()
-    ).count();
+size_t StorageEngine::owner_core(std::string_view key) const {
+    return cores_ == 0 ? 0 : shard_owner_[shard_index(hash_key(key))];
 }
 
-bool StorageEngine::get(const std::string& key, std::string& value) {
-    Value v;
-    if (!shard_for(key).get(key, v, now_seconds())) {
-        return false;
-    }
-    value = v.data;
-    return true;
+size_t StorageEngine::scan_owner_core(uint64_t cursor) const {
+    size_t shard = static_cast<size_t>(cursor >> SCAN_SHARD_SHIFT);
+    return cores_ == 0 || shard >= shards_.size() ? 0 : shard_owner_[shard];
+}
+
+void StorageEngine::bind_core(size_t core) {
+    current_core = core;
+}
+
+bool StorageEngine::get(std::string_view key, Value& value) {
+    uint64_t h = hash_key(key);
+    return shards_[shard_index(h)].get(key, h, value, now_ms());
+}
+
+bool StorageEngine::store(std::string_view key, std::string_view value, uint64_t expire_at) {
+    uint64_t h = hash_key(key);
+    std::vector<std::string> evicted;
+    bool ok = shards_[shard_index(h)].set(key, h, value, expire_at, now_ms(),
+                                          aof_writer_ ? &evicted : nullptr);
+    // Evictions are logged so that replay does not bring the keys back.
+    for (const auto& k : evicted)
+        aof_writer_->append_del(k);
+    return ok;
 }
 
-void StorageEngine::set(const std::string& key, std::string value) {
-    shard_for(key).set(key, Value{value});
+bool StorageEngine::set(std::string_view key, std::string_view value) {
+    if (!store(key, value, 0))
+        return false;
     if (aof_writer_) {
         aof_writer_->append_set(key, value);
     }
+    return true;
 }
 
+bool StorageEngine::set_with_ttl(std::string_view key, std::string_view value, uint64_t ttl_ms) {
+    return set_with_expire_at(key, value, now_ms() + ttl_ms);
+}
 
-void StorageEngine::set_with_ttl(
-    const std::string& key,
-    std::string value,
-    uint64_t ttl_seconds
+bool StorageEngine::set_with_expire_at(
+    std::string_view key,
+    std::string_view value,
+    uint64_t expire_at_ms
 ) {
-    uint64_t expire_at = now_seconds() + ttl_seconds;
-    shard_for(key).set(key, Value{value, expire_at});
-
+    expire_at_ms = std::max<uint64_t>(expire_at_ms, 1);  // 0 would mean "never"
+    if (!store(key, value, expire_at_ms))
+        return false;
     if (aof_writer_) {
-        aof_writer_->append_setex(key, ttl_seconds, value);
+        aof_writer_->append_set_expire_at(key, value, expire_at_ms);
     }
+    return true;
 }
 
-
-bool StorageEngine::del(const std::string& key) {
-    bool res = shard_for(key).del(key);
+bool StorageEngine::del(std::string_view key) {
+    uint64_t h = hash_key(key);
+    bool res = shards_[shard_index(h)].del(key, h, now_ms());
     if (res && aof_writer_) {
         aof_writer_->append_del(key);
     }
     return res;
 }
 
-bool StorageEngine::exists(const std::string& key) {
-    return shard_for(key).exists(key, now_seconds());
+bool StorageEngine::exists(std::string_view key) {
+    uint64_t h = hash_key(key);
+    return shards_[shard_index(h)].exists(key, h, now_ms());
+}
+
+bool StorageEngine::expire(std::string_view key, uint64_t ttl_ms) {
+    return expire_at(key, now_ms() + ttl_ms);
 }
 
-bool StorageEngine::expire(const std::string& key, uint64_t ttl_seconds) {
-    uint64_t expire_at = now_seconds() + ttl_seconds;
-    bool res = shard_for(key).set_expire(key, expire_at, now_seconds());
+bool StorageEngine::expire_at(std::string_view key, uint64_t expire_at_ms) {
+    expire_at_ms = std::max<uint64_t>(expire_at_ms, 1);
+    uint64_t h = hash_key(key);
+    bool res = shards_[shard_index(h)].set_expire(key, h, expire_at_ms, now_ms());
     if (res && aof_writer_) {
-        aof_writer_->append_expire(key, ttl_seconds);
+        aof_writer_->append_expire_at(key, expire_at_ms);
     }
     return res;
 }
 
-int64_t StorageEngine::ttl(const std::string& key) {
-    return shard_for(key).ttl(key, now_seconds());
+int64_t StorageEngine::ttl(std::string_view key) {
+    int64_t ms = pttl(key);
+    return ms < 0 ? ms : (ms + 500) / 1000;
 }
 
-std::vector<std::string> StorageEngine::keys(const std::string& pattern) {
+int64_t StorageEngine::pttl(std::string_view key) {
+    uint64_t h = hash_key(key);
+    return shards_[shard_index(h)].pttl(key, h, now_ms());
+}
+
+bool StorageEngine::owns_shard(size_t i) const {
+    return cores_ == 0 || shard_owner_[i] == current_core;
+}
+
+void StorageEngine::for_each_shard(const std::function<void(size_t)>& fn) {
+    if (cores_ == 0 && pool_ && pool_->size() > 0) {
+        size_t total = 0;
+        for (const Shard& shard : shards_)
+            total += shard.size();
+        if (total >= PARALLEL_MIN_KEYS) {
+            pool_->parallel_for(shards_.size(), fn);
+            return;
+        }
+    }
+    for (size_t i = 0; i < shards_.size(); ++i)
+        if (owns_shard(i))
+            fn(i);
+}
+
+std::vector<std::string> StorageEngine::keys(std::string_view pattern) {
+    Glob glob(pattern);
+    uint64_t now = now_ms();
+    std::vector<std::vector<std::string>> parts(shards_.size());
+    for_each_shard([&](size_t i) { shards_[i].keys(now, glob, parts[i]); });
+
+    size_t total = 0;
+    for (const auto& part : parts)
+        total += part.size();
     std::vector<std::string> out;
-    uint64_t now = now_seconds();
-    for (auto& shard : shards_)
-        shard.keys(now, out);
+    out.reserve(total);
+    for (auto& part : parts)
+        std::move(part.begin(), part.end(), std::back_inserter(out));
+    return out;
+}
+
+void StorageEngine::set_maxmemory(size_t bytes, EvictionPolicy policy, size_t samples) {
+    maxmemory_ = bytes;
+    eviction_policy_ = policy;
+    size_t share = bytes == 0 ? 0 : std::max<size_t>(bytes / shards_.size(), 1);
+    for (Shard& shard : shards_)
+        shard.set_memory_budget(share, policy, samples);
+}
+
+uint64_t StorageEngine::evicted_keys() const {
+    uint64_t total = 0;
+    for (const Shard& shard : shards_)
+        total += shard.evicted_keys();
+    return total;
+}
+
+bool StorageEngine::key_memory(std::string_view key, size_t& out) {
+    uint64_t h = hash_key(key);
+    return shards_[shard_index(h)].key_memory(key, h, now_ms(), out);
+}
+
+size_t StorageEngine::dbsize() {
+    std::vector<size_t> sizes(shards_.size(), 0);
+    for_each_shard([&](size_t i) { sizes[i] = shards_[i].size(); });
+    size_t total = 0;
+    for (size_t n : sizes)
+        total += n;
+    return total;
+}
+
+void StorageEngine::flush_all() {
+    // One record per shard, not one per call: in mesh mode each core
+    // flushes its own shards at its own point in the log, and a write a
+    // core takes after its part must not be wiped by another core's.
+    for_each_shard([&](size_t i) {
+        shards_[i].clear([&] {
+            if (aof_writer_)
+                aof_writer_->append_flush_shard(i, shards_.size());
+        });
+    });
+}
+
+void StorageEngine::flush_slot(size_t slot, size_t shards) {
+    if (shards == 0 || !std::has_single_bit(shards) || slot >= shards)
+        return;
+    if (shards <= shards_.size()) {
+        // Each of our shards lies wholly inside one of theirs.
+        for (size_t i = 0; i < shards_.size(); ++i)
+            if ((i & (shards - 1)) == slot)
+                shards_[i].clear();
+        return;
+    }
+    // Theirs is a part of one of ours: pick its keys out by hash.
+    Shard& shard = shards_[slot & shard_mask_];
+    uint64_t now = now_ms();
+    std::vector<std::string> keys;
+    shard.keys(now, Glob("*"), keys);
+    for (const auto& k : keys) {
+        uint64_t h = hash_key(k);
+        if (((h >> 32) & (shards - 1)) == slot)
+            shard.del(k, h, now);
+    }
+}
+
+uint64_t StorageEngine::scan(
+    uint64_t cursor,
+    size_t count,
+    std::string_view pattern,
+    std::vector<std::string>& out
+) {
+    size_t shard = static_cast<size_t>(cursor >> SCAN_SHARD_SHIFT);
+    uint64_t pos = cursor & SCAN_POS_MASK;
+    uint64_t now = now_ms();
+    size_t start = out.size();
+    count = std::max<size_t>(count, 1);
+
+    // Move on to the next shard while the step has room, as long as this
+    // thread may touch it (mesh mode: another core's shard ends the step).
+    while (shard < shards_.size()) {
+        pos = shards_[shard].scan(pos, count - (out.size() - start), now, out);
+        if (pos != 0)
+            break;
+        ++shard;
+        if (out.size() - start >= count || shard == shards_.size() || !owns_shard(shard))
+            break;
+    }
+
     if (pattern != "*") {
-        std::vector<std::string> filtered;
-        for (const auto& k : out) {
-            if (match_pattern(pattern, k))
-                filtered.push_back(k);
+        Glob glob(pattern);
+        auto first = out.begin() + static_cast<std::ptrdiff_t>(start);
+        out.erase(std::remove_if(first, out.end(),
+                                 [&](const std::string& k) { return !glob.matches(k); }),
+                  out.end());
+    }
+    return shard >= shards_.size() ? 0 : (static_cast<uint64_t>(shard) << SCAN_SHARD_SHIFT) | pos;
+}
+
+size_t StorageEngine::active_expire(size_t budget, bool& backlog) {
+    size_t expired = 0;
+    uint64_t now = now_ms();
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        if (owns_shard(i))
+            expired += shards_[i].expire_slice(now, budget, backlog);
+    }
+    return expired;
+}
+
+void StorageEngine::active_rehash(size_t slots, bool& backlog) {
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        if (owns_shard(i) && shards_[i].rehash_slice(slots))
+            backlog = true;
+    }
+}
+
+size_t StorageEngine::active_defrag(size_t budget, bool& running) {
+    size_t moved = 0;
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        if (!owns_shard(i))
+            continue;
+        if (defrag_enabled_)
+            moved += shards_[i].defrag_slice(budget, defrag_threshold_pct_, running);
+        else
+            shards_[i].reclaim();
+    }
+    return moved;
+}
+
+uint64_t StorageEngine::defrag_hits() const {
+    uint64_t total = 0;
+    for (const Shard& shard : shards_)
+        total += shard.defrag_hits();
+    return total;
+}
+
+void StorageEngine::active_aof_rewrite(bool& backlog) {
+    if (!aof_rewriter_)
+        return;
+    if (cores_ == 0 || current_core == 0)
+        aof_rewriter_->start_if_due();
+    if (!aof_rewriter_->snapshotting())
+        return;
+    backlog = true;
+    uint64_t now = now_ms();
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        if (owns_shard(i) && aof_rewriter_->claim(i)) {
+            Shard::Snapshot snapshot;
+            shards_[i].snapshot(now, snapshot);
+            aof_rewriter_->deliver(std::move(snapshot));
+            return;  // one shard per cycle keeps each pause short
         }
-        return filtered;
     }
-    return out;
 }
 
-void StorageEngine::enable_aof(const std::string& filename, bool flush_each_write) {
+bool StorageEngine::enable_aof(const std::string& filename, AofFsync policy) {
     AOFReader reader(filename);
-    reader.replay(*this);
-    aof_writer_ = std::make_unique<AOFWriter>(filename, flush_each_write);
+    if (!reader.replay(*this))
+        return false;
+    aof_writer_ = std::make_unique<AOFWriter>(filename, policy);
+    if (!aof_writer_->is_open()) {
+        aof_writer_.reset();
+        return false;
+    }
+    aof_rewriter_ = std::make_unique<AOFRewriter>(*aof_writer_, filename, shards_.size());
+    return true;
 }
 
 } // namespace mini_redis
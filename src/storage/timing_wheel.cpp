@@ -0,0 +1,124 @@
+#include "storage/timing_wheel.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <iterator>
+
+namespace mini_redis {
+
+void TimingWheel::schedule(std::string_view key, uint64_t hash, uint64_t deadline, uint64_t now) {
+    if (count_ == 0)
+        current_ = std::max(current_, now);
+    place(Entry{std::string(key), hash, deadline});
+}
+
+void TimingWheel::schedule(Entry&& entry) {
+    place(std::move(entry));
+}
+
+void TimingWheel::place(Entry&& entry) {
+    if (entry.deadline <= current_) {
+        due_.push_back(std::move(entry));
+        return;
+    }
+    uint64_t delta = entry.deadline - current_;
+    ++count_;
+    for (size_t level = 0; level < LEVELS; ++level) {
+        if (delta < (uint64_t{1} << (BITS * (level + 1)))) {
+            size_t slot = (entry.deadline >> (BITS * level)) & (SLOTS - 1);
+            slots_[level][slot].push_back(std::move(entry));
+            occupied_[level] |= uint64_t{1} << slot;
+            return;
+        }
+    }
+    overflow_.push_back(std::move(entry));
+}
+
+uint64_t TimingWheel::next_event() const {
+    // Level 0 fires slot t & 63 at tick t; level L >= 1 cascades slot
+    // (t >> 6L) & 63 at the boundary t = k << 6L. Every filed entry is at
+    // most 64 such steps ahead on its level, so rotating the bitmap to start
+    // just past the current position finds the next occupied one.
+    uint64_t next = UINT64_MAX;
+    for (size_t level = 0; level < LEVELS; ++level) {
+        if (!occupied_[level])
+            continue;
+        unsigned shift = BITS * static_cast<unsigned>(level);
+        uint64_t pos = current_ >> shift;
+        uint64_t rotated = std::rotr(occupied_[level], static_cast<int>((pos + 1) & (SLOTS - 1)));
+        uint64_t step = static_cast<uint64_t>(std::countr_zero(rotated)) + 1;
+        next = std::min(next, (pos + step) << shift);
+    }
+    if (!overflow_.empty()) {
+        unsigned shift = BITS * LEVELS;
+        next = std::min(next, ((current_ >> shift) + 1) << shift);
+    }
+    return next;
+}
+
+void TimingWheel::cascade(size_t level) {
+    size_t slot = (current_ >> (BITS * level)) & (SLOTS - 1);
+    if (!(occupied_[level] & (uint64_t{1} << slot)))
+        return;
+    std::vector<Entry> entries;
+    entries.swap(slots_[level][slot]);
+    occupied_[level] &= ~(uint64_t{1} << slot);
+    count_ -= entries.size();
+    for (Entry& e : entries)
+        place(std::move(e));
+}
+
+void TimingWheel::advance(uint64_t now) {
+    while (count_ > 0) {
+        uint64_t t = next_event();
+        if (t > now)
+            break;
+        current_ = t;
+
+        // Top down, so entries moved to a lower level whose boundary is also
+        // t are pushed on down in the same pass.
+        if (!overflow_.empty() && (t & ((uint64_t{1} << (BITS * LEVELS)) - 1)) == 0) {
+            std::vector<Entry> entries;
+            entries.swap(overflow_);
+            count_ -= entries.size();
+            for (Entry& e : entries)
+                place(std::move(e));
+        }
+        for (size_t level = LEVELS - 1; level > 0; --level)
+            if ((t & ((uint64_t{1} << (BITS * level)) - 1)) == 0)
+                cascade(level);
+
+        size_t slot = t & (SLOTS - 1);
+        if (occupied_[0] & (uint64_t{1} << slot)) {
+            auto& fired = slots_[0][slot];
+            count_ -= fired.size();
+            if (due_.empty())
+                due_.swap(fired);
+            else
+                std::move(fired.begin(), fired.end(), std::back_inserter(due_));
+            fired.clear();
+            occupied_[0] &= ~(uint64_t{1} << slot);
+        }
+    }
+    current_ = std::max(current_, now);
+}
+
+void TimingWheel::clear() {
+    for (auto& level : slots_)
+        for (auto& slot : level)
+            slot.clear();
+    occupied_.fill(0);
+    overflow_.clear();
+    due_.clear();
+    count_ = 0;
+}
+
+bool TimingWheel::pop_due(Entry& out) {
+    if (due_.empty())
+        return false;
+    out = std::move(due_.back());
+    due_.pop_back();
+    return true;
+}
+
+} // namespace mini_redis
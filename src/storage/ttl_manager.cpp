@@ -0,0 +1,84 @@
+#include "storage/ttl_manager.hpp"
+#include "storage/storage_engine.hpp"
+#include "common/time.hpp"
+#include "concurrency/epoch.hpp"
+#include <chrono>
+
+namespace mini_redis {
+
+namespace {
+
+constexpr size_t SLICE_KEYS = 64;   // keys expired per shard per cycle
+constexpr size_t REHASH_SLOTS = 1024;  // slots of a table mid-rehash moved per shard per cycle
+constexpr size_t DEFRAG_SLOTS = 512;  // table slots defrag looks at per shard per cycle
+constexpr int CYCLE_MS = 100;       // between cycles when nothing is due
+constexpr int FAST_CYCLE_MS = 1;    // between cycles while a backlog drains (or a rehash, defrag or AOF rewrite runs)
+constexpr uint64_t SAMPLE_MS = 1000;
+
+} // namespace
+
+TtlManager::TtlManager(StorageEngine& storage) : storage_(storage) {}
+
+TtlManager::~TtlManager() {
+    stop();
+}
+
+void TtlManager::start() {
+    if (thread_.joinable())
+        return;
+    stopping_ = false;
+    thread_ = std::thread([this] {
+        std::unique_lock lock(mutex_);
+        while (!stopping_) {
+            lock.unlock();
+            int wait_ms = run_cycle();
+            lock.lock();
+            wake_.wait_for(lock, std::chrono::milliseconds(wait_ms), [this] { return stopping_; });
+        }
+    });
+}
+
+void TtlManager::stop() {
+    {
+        std::lock_guard lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    if (thread_.joinable())
+        thread_.join();
+}
+
+int TtlManager::run_cycle() {
+    bool backlog = false;
+    record(storage_.active_expire(SLICE_KEYS, backlog));
+    storage_.active_rehash(REHASH_SLOTS, backlog);
+    storage_.active_defrag(DEFRAG_SLOTS, backlog);
+    storage_.active_aof_rewrite(backlog);
+    // Entries this cycle replaced, so their slabs can empty while idle.
+    concurrency::flush_retired();
+    return backlog ? FAST_CYCLE_MS : CYCLE_MS;
+}
+
+void TtlManager::record(size_t expired) {
+    expired_.fetch_add(expired, std::memory_order_relaxed);
+
+    // Mesh cores all report here; whichever gets the lock closes the window.
+    std::unique_lock lock(sample_mutex_, std::try_to_lock);
+    if (!lock.owns_lock())
+        return;
+    uint64_t total = expired_.load(std::memory_order_relaxed);
+    uint64_t now = now_ms();
+    if (sample_start_ms_ == 0) {
+        sample_start_ms_ = now;
+        sample_expired_ = total;
+        return;
+    }
+    uint64_t elapsed = now - sample_start_ms_;
+    if (elapsed < SAMPLE_MS)
+        return;
+    rate_.store((total - sample_expired_) * 1000 / elapsed, std::memory_order_relaxed);
+    sample_start_ms_ = now;
+    sample_expired_ = total;
+}
+
+} // namespace mini_redis
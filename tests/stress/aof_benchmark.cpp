@@ -0,0 +1,109 @@
+// AOF benchmark: `threads` writers log `records` SETs over `keys` distinct
+// keys through AOFWriter (appendfsync no), then the file is replayed into
+// a fresh StorageEngine. The same records as older text lines are replayed
+// too, for the line path.
+//
+// Usage: ./build/aof_benchmark [records] [keys] [value_len] [threads]
+//        (default 5000000 records, 1000000 keys, 64 bytes, 4 threads)
+
+#include "persistence/aof_reader.hpp"
+#include "persistence/aof_writer.hpp"
+#include "storage/storage_engine.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr const char* AOF_PATH = "aof_benchmark.aof";
+constexpr const char* TEXT_PATH = "aof_benchmark.txt";
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+size_t file_bytes(const char* path) {
+    FILE* f = std::fopen(path, "rb");
+    if (!f)
+        return 0;
+    std::fseek(f, 0, SEEK_END);
+    size_t n = static_cast<size_t>(std::ftell(f));
+    std::fclose(f);
+    return n;
+}
+
+void report(const char* phase, size_t records, size_t bytes, double secs) {
+    std::printf("%-14s %10.2f s %12.0f rec/s %10.1f MB/s\n", phase, secs, records / secs,
+                bytes / 1048576.0 / secs);
+    std::fflush(stdout);
+}
+
+void replay(const char* phase, const char* path, size_t records) {
+    mini_redis::StorageEngine engine(64);
+    auto start = std::chrono::steady_clock::now();
+    mini_redis::AOFReader reader(path);
+    if (!reader.replay(engine))
+        std::printf("%s: replay failed\n", phase);
+    report(phase, records, file_bytes(path), seconds_since(start));
+    if (engine.dbsize() == 0)
+        std::printf("%s: nothing loaded\n", phase);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t records = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 5000000;
+    size_t keys = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1000000;
+    size_t value_len = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 64;
+    size_t threads = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : 4;
+    keys = keys ? keys : 1;
+    threads = threads ? threads : 1;
+    std::string value(value_len, 'v');
+    auto key = [&](size_t i) { return "key:" + std::to_string(i % keys); };
+
+    std::remove(AOF_PATH);
+    std::remove(TEXT_PATH);
+    std::printf("%zu records, %zu keys, %zu-byte values, %zu writer threads\n", records, keys,
+                value_len, threads);
+
+    {
+        auto start = std::chrono::steady_clock::now();
+        uint64_t writes = 0;
+        {
+            mini_redis::AOFWriter aof(AOF_PATH, mini_redis::AofFsync::NO);
+            std::vector<std::thread> writers;
+            for (size_t t = 0; t < threads; ++t) {
+                writers.emplace_back([&, t] {
+                    for (size_t i = t; i < records; i += threads)
+                        aof.append_set(key(i), value);
+                });
+            }
+            for (auto& w : writers)
+                w.join();
+            writes = aof.writes();
+        }  // the destructor writes out the rest
+        report("append", records, file_bytes(AOF_PATH), seconds_since(start));
+        std::printf("%-14s %10llu write() calls\n", "", static_cast<unsigned long long>(writes));
+    }
+    replay("replay", AOF_PATH, records);
+
+    {
+        FILE* f = std::fopen(TEXT_PATH, "wb");
+        if (!f) {
+            std::perror("fopen");
+            return 1;
+        }
+        for (size_t i = 0; i < records; ++i)
+            std::fprintf(f, "SET %s %s\n", key(i).c_str(), value.c_str());
+        std::fclose(f);
+    }
+    replay("replay (text)", TEXT_PATH, records);
+
+    std::remove(AOF_PATH);
+    std::remove(TEXT_PATH);
+    return 0;
+}
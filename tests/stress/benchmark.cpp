@@ -69,7 +69,7 @@ int main(int argc, char** argv) {
     
     std::cout << "Benchmark: " << total_requests << " requests, " 
               << num_threads << " threads (" << per_thread << " per thread)\n";
-    std::cout << "Make sure server is running with aof_fsync=no\n";
+    std::cout << "Make sure server is running with appendfsync=no\n";
     
     auto start = std::chrono::high_resolution_clock::now();
     
@@ -0,0 +1,142 @@
+// Fragmentation benchmark: one shard's entries under churn, allocated the
+// way they were before the slab arena (ConcurrentMap<Value> on the heap)
+// and the way Shard allocates them now (SlabArena, plus active defrag).
+// Reports RSS growth against the bytes the entries actually hold after each
+// phase. Each variant runs in its own child process so their RSS does not mix.
+//
+// Phases: fill `keys` entries with 16..512-byte values; delete a random
+// three quarters; refill a third as many with 600..1000-byte values (a
+// different size mix, as when a workload changes). The arena variant runs
+// a full defrag pass after the delete and the refill, as the background
+// cycle would.
+//
+// Usage: ./build/fragmentation_benchmark [keys]   (default 1000000)
+
+#include "common/hash.hpp"
+#include "common/memory_stats.hpp"
+#include "storage/concurrent_map.hpp"
+#include "storage/shard.hpp"
+#include "storage/value.hpp"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr size_t DEFRAG_SLOTS = 4096;
+constexpr size_t DEFRAG_THRESHOLD_PCT = 10;
+
+struct Workload {
+    std::vector<std::string> keys;
+    std::vector<size_t> value_len;
+    std::vector<size_t> deleted;  // indices into keys
+    std::vector<std::string> refill_keys;
+    std::vector<size_t> refill_len;
+};
+
+Workload make_workload(size_t n) {
+    std::mt19937_64 rng(42);
+    Workload w;
+    for (size_t i = 0; i < n; ++i) {
+        w.keys.push_back("key:" + std::to_string(i));
+        w.value_len.push_back(16 + rng() % 497);
+    }
+    std::vector<size_t> order(n);
+    for (size_t i = 0; i < n; ++i)
+        order[i] = i;
+    std::shuffle(order.begin(), order.end(), rng);
+    w.deleted.assign(order.begin(), order.begin() + static_cast<std::ptrdiff_t>(n * 3 / 4));
+    for (size_t i = 0; i < n / 3; ++i) {
+        w.refill_keys.push_back("new:" + std::to_string(i));
+        w.refill_len.push_back(600 + rng() % 401);
+    }
+    return w;
+}
+
+void report(const char* variant, const char* phase, size_t live, size_t rss_base) {
+    size_t rss = mini_redis::resident_bytes() - rss_base;
+    std::printf("%-8s %-10s %10.1f %10.1f %8.2f\n", variant, phase, live / 1048576.0,
+                rss / 1048576.0, live ? static_cast<double>(rss) / live : 0.0);
+    std::fflush(stdout);
+}
+
+// Before: nodes, keys and blobs straight from the heap.
+void run_heap(const Workload& w, const std::string& bytes) {
+    size_t base = mini_redis::resident_bytes();
+    mini_redis::ConcurrentMap<mini_redis::Value> map;
+    map.set_deferred_reclaim(false);
+    auto put = [&](const std::string& k, size_t len) {
+        map.insert_or_assign(k, mini_redis::hash_key(k),
+                             mini_redis::Value(std::string_view(bytes).substr(0, len)));
+    };
+    for (size_t i = 0; i < w.keys.size(); ++i)
+        put(w.keys[i], w.value_len[i]);
+    report("heap", "fill", map.memory_bytes(), base);
+    for (size_t i : w.deleted)
+        map.erase(w.keys[i], mini_redis::hash_key(w.keys[i]));
+    report("heap", "delete", map.memory_bytes(), base);
+    for (size_t i = 0; i < w.refill_keys.size(); ++i)
+        put(w.refill_keys[i], w.refill_len[i]);
+    report("heap", "refill", map.memory_bytes(), base);
+}
+
+// After: the shard's arena, then defrag.
+void run_slab(const Workload& w, const std::string& bytes) {
+    size_t base = mini_redis::resident_bytes();
+    mini_redis::Shard shard;
+    shard.set_exclusive(true);
+    auto put = [&](const std::string& k, size_t len) {
+        shard.set(k, mini_redis::hash_key(k), std::string_view(bytes).substr(0, len), 0, 1);
+    };
+    auto live = [&] { return shard.memory_bytes(); };
+    size_t moved = 0;
+    auto defrag = [&] {
+        for (bool running = true; running;) {
+            running = false;
+            moved += shard.defrag_slice(DEFRAG_SLOTS, DEFRAG_THRESHOLD_PCT, running);
+        }
+        report("slab", "defrag", live(), base);
+    };
+    for (size_t i = 0; i < w.keys.size(); ++i)
+        put(w.keys[i], w.value_len[i]);
+    report("slab", "fill", live(), base);
+    for (size_t i : w.deleted)
+        shard.del(w.keys[i], mini_redis::hash_key(w.keys[i]), 1);
+    report("slab", "delete", live(), base);
+    defrag();
+    for (size_t i = 0; i < w.refill_keys.size(); ++i)
+        put(w.refill_keys[i], w.refill_len[i]);
+    report("slab", "refill", live(), base);
+    defrag();
+    std::printf("%-8s %zu entries moved\n", "slab", moved);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    Workload w = make_workload(n);
+    std::string bytes(1024, 'x');
+
+    std::printf("%zu keys; live = bytes the entries hold, RSS = growth over the start\n", n);
+    std::printf("%-8s %-10s %10s %10s %8s\n", "alloc", "phase", "live MB", "RSS MB", "RSS/live");
+    std::fflush(stdout);
+    for (auto run : {run_heap, run_slab}) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            run(w, bytes);
+            std::fflush(stdout);
+            std::_Exit(0);
+        }
+        int status = 0;
+        waitpid(pid, &status, 0);
+    }
+    return 0;
+}
@@ -0,0 +1,175 @@
+// Shard map micro-benchmark: std::unordered_map<std::string, Value> (the
+// original Shard::Map), SwissMap<Value>, and ConcurrentMap<Value> (the
+// current one, whose entries are separate nodes so readers need no lock). Reports insert and lookup latency,
+// the slowest single insert (a full rehash, for the maps that do one at
+// once), and heap bytes per key, counted by the global allocator hooks
+// below as a typical malloc would charge them (8-byte chunk header, 16-byte
+// rounding).
+//
+// Usage: ./build/map_benchmark [keys] [key_len]   (default 1000000 keys, 16 bytes)
+
+#include "storage/concurrent_map.hpp"
+#include "storage/swiss_map.hpp"
+#include "storage/value.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+size_t live_bytes = 0;
+
+size_t footprint(size_t n) {
+    return std::max<size_t>(32, (n + 8 + 15) & ~size_t{15});
+}
+
+// Every allocation carries a header recording its size.
+constexpr size_t HEADER = 16;
+
+void* counted_alloc(size_t n, size_t align) {
+    size_t header = std::max(HEADER, align);
+    void* raw = std::aligned_alloc(header, (n + 2 * header - 1) / header * header);
+    if (!raw) throw std::bad_alloc();
+    char* p = static_cast<char*>(raw) + header;
+    reinterpret_cast<size_t*>(p)[-1] = n;
+    reinterpret_cast<size_t*>(p)[-2] = header;
+    live_bytes += footprint(n);
+    return p;
+}
+
+void counted_free(void* ptr) {
+    if (!ptr) return;
+    char* p = static_cast<char*>(ptr);
+    live_bytes -= footprint(reinterpret_cast<size_t*>(p)[-1]);
+    std::free(p - reinterpret_cast<size_t*>(p)[-2]);
+}
+
+} // namespace
+
+void* operator new(size_t n) { return counted_alloc(n, HEADER); }
+void* operator new[](size_t n) { return counted_alloc(n, HEADER); }
+void* operator new(size_t n, std::align_val_t a) { return counted_alloc(n, static_cast<size_t>(a)); }
+void* operator new[](size_t n, std::align_val_t a) { return counted_alloc(n, static_cast<size_t>(a)); }
+void operator delete(void* p) noexcept { counted_free(p); }
+void operator delete[](void* p) noexcept { counted_free(p); }
+void operator delete(void* p, size_t) noexcept { counted_free(p); }
+void operator delete[](void* p, size_t) noexcept { counted_free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { counted_free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { counted_free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { counted_free(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { counted_free(p); }
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double ns_per_op(Clock::time_point start, size_t ops) {
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    return static_cast<double>(ns) / static_cast<double>(ops);
+}
+
+struct Result {
+    double insert_ns;
+    double max_insert_us;
+    double hit_ns;
+    double miss_ns;
+    double bytes_per_key;
+};
+
+template <typename Map, typename Insert, typename Find>
+Result run(const std::vector<std::string>& keys,
+           const std::vector<std::string>& lookups,
+           const std::vector<std::string>& misses,
+           Insert insert, Find find) {
+    Result r{};
+    size_t before = live_bytes;
+    auto* map = new Map();
+    if constexpr (requires { map->set_deferred_reclaim(false); })
+        map->set_deferred_reclaim(false);  // single-threaded: free at once
+
+    auto start = Clock::now();
+    Clock::duration slowest{};
+    for (auto last = start; const auto& k : keys) {
+        insert(*map, k);
+        auto now = Clock::now();
+        slowest = std::max(slowest, now - last);
+        last = now;
+    }
+    r.insert_ns = ns_per_op(start, keys.size());
+    r.max_insert_us = std::chrono::duration<double, std::micro>(slowest).count();
+    size_t bytes = live_bytes - before;
+    if constexpr (requires { map->memory_usage(); })
+        bytes += map->memory_usage().table;  // mapped straight from the OS, past the hooks
+    r.bytes_per_key = static_cast<double>(bytes) / static_cast<double>(keys.size());
+
+    size_t found = 0;
+    start = Clock::now();
+    for (const auto& k : lookups)
+        found += find(*map, k);
+    r.hit_ns = ns_per_op(start, lookups.size());
+
+    start = Clock::now();
+    for (const auto& k : misses)
+        found += find(*map, k);
+    r.miss_ns = ns_per_op(start, misses.size());
+
+    if (found != lookups.size())
+        std::fprintf(stderr, "lookup mismatch: %zu of %zu\n", found, lookups.size());
+    delete map;
+    return r;
+}
+
+std::string make_key(const char* prefix, size_t i, size_t len) {
+    std::string k = prefix + std::to_string(i);
+    if (k.size() < len) k.append(len - k.size(), 'x');
+    return k;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    size_t key_len = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 16;
+
+    std::vector<std::string> keys, lookups, misses;
+    keys.reserve(n);
+    misses.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        keys.push_back(make_key("key:", i, key_len));
+        misses.push_back(make_key("miss:", i, key_len));
+    }
+    lookups = keys;
+    std::mt19937_64 rng(42);
+    std::shuffle(lookups.begin(), lookups.end(), rng);
+
+    using Value = mini_redis::Value;
+    using StdMap = std::unordered_map<std::string, Value>;
+    using Swiss = mini_redis::SwissMap<Value>;
+    using Concurrent = mini_redis::ConcurrentMap<Value>;
+
+    Result std_r = run<StdMap>(keys, lookups, misses,
+        [](StdMap& m, const std::string& k) { m[k] = Value("v"); },
+        [](StdMap& m, const std::string& k) { return m.find(k) != m.end() ? 1 : 0; });
+    Result swiss_r = run<Swiss>(keys, lookups, misses,
+        [](Swiss& m, const std::string& k) { m.insert_or_assign(k, Value("v")); },
+        [](Swiss& m, const std::string& k) { return m.find(k) ? 1 : 0; });
+    Result conc_r = run<Concurrent>(keys, lookups, misses,
+        [](Concurrent& m, const std::string& k) { m.insert_or_assign(k, Value("v")); },
+        [](Concurrent& m, const std::string& k) { return m.find(k) ? 1 : 0; });
+
+    std::printf("%zu keys of %zu bytes, value = Value{\"v\"}\n", n, key_len);
+    std::printf("%-16s %12s %14s %12s %12s %12s\n", "map", "insert ns", "max insert us",
+                "hit ns", "miss ns", "bytes/key");
+    for (auto [name, r] : {std::pair{"unordered_map", std_r}, std::pair{"SwissMap", swiss_r},
+                           std::pair{"ConcurrentMap", conc_r}})
+        std::printf("%-16s %12.1f %14.1f %12.1f %12.1f %12.1f\n", name, r.insert_ns,
+                    r.max_insert_us, r.hit_ns, r.miss_ns, r.bytes_per_key);
+    return 0;
+}
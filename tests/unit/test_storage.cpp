@@ -0,0 +1,105 @@
+// ConcurrentMap under concurrent reads: readers look up keys that are
+// always present while a writer grows the table through one incremental
+// rehash after another. Any miss is a reader that lost a live key mid-rehash.
+//
+// Usage: ./build/test_storage [seconds] [readers]   (default 2 s, 3 readers)
+
+#include "concurrency/epoch.hpp"
+#include "storage/concurrent_map.hpp"
+#include "storage/value.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Map = mini_redis::ConcurrentMap<mini_redis::Value>;
+
+constexpr size_t STABLE_KEYS = 64;     // present for a whole round
+constexpr size_t CHURN_KEYS = 4096;    // inserted to drive the table through its growths
+
+struct Reader {
+    std::atomic<uint64_t> seen_round{0};  // last round fully read
+    uint64_t lookups = 0;
+    uint64_t misses = 0;
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    double seconds = argc > 1 ? std::atof(argv[1]) : 2.0;
+    size_t reader_count = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 3;
+    reader_count = reader_count ? reader_count : 1;
+
+    std::vector<std::string> stable;
+    for (size_t i = 0; i < STABLE_KEYS; ++i)
+        stable.push_back("stable:" + std::to_string(i));
+
+    // Two maps take turns: one is read while the other is refilled, once
+    // every reader has moved off it.
+    Map maps[2];
+    std::atomic<uint64_t> round{0};
+    std::atomic<bool> stop{false};
+    std::vector<Reader> readers(reader_count);
+
+    std::vector<std::thread> threads;
+    for (Reader& r : readers) {
+        threads.emplace_back([&] {
+            while (!stop.load(std::memory_order_relaxed)) {
+                uint64_t n = round.load(std::memory_order_acquire);
+                if (n == 0)
+                    continue;
+                const Map& m = maps[n % 2];
+                {
+                    mini_redis::concurrency::EpochGuard guard;
+                    for (const std::string& k : stable) {
+                        ++r.lookups;
+                        if (!m.find(k))
+                            ++r.misses;
+                    }
+                }
+                r.seen_round.store(n, std::memory_order_release);
+            }
+        });
+    }
+
+    auto wait_readers = [&](uint64_t n) {
+        for (Reader& r : readers)
+            while (r.seen_round.load(std::memory_order_acquire) < n)
+                std::this_thread::yield();
+    };
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(seconds);
+    uint64_t n = 0;
+    while (std::chrono::steady_clock::now() < deadline) {
+        ++n;
+        Map& m = maps[n % 2];
+        m.clear();
+        for (const std::string& k : stable)
+            m.insert_or_assign(k, mini_redis::Value("v"));
+        round.store(n, std::memory_order_release);
+        for (size_t i = 0; i < CHURN_KEYS; ++i)
+            m.insert_or_assign("churn:" + std::to_string(i), mini_redis::Value("c"));
+        while (m.rehash_step(CHURN_KEYS)) {
+        }
+        wait_readers(n);
+    }
+    stop = true;
+    for (auto& t : threads)
+        t.join();
+    mini_redis::concurrency::flush_retired();
+
+    uint64_t lookups = 0, misses = 0;
+    for (const Reader& r : readers) {
+        lookups += r.lookups;
+        misses += r.misses;
+    }
+    std::printf("%llu rounds, %llu lookups, %llu false misses\n", static_cast<unsigned long long>(n),
+                static_cast<unsigned long long>(lookups), static_cast<unsigned long long>(misses));
+    return misses == 0 ? 0 : 1;
+}